@@ -3,6 +3,61 @@
 
 using namespace QPI;
 
+// Table sizes, overridable at build time. Both must be powers of 2.
+#ifndef ETHBRIDGE_ORDER_CAPACITY
+#define ETHBRIDGE_ORDER_CAPACITY 256
+#endif
+
+#ifndef ETHBRIDGE_MANAGER_CAPACITY
+#define ETHBRIDGE_MANAGER_CAPACITY 64
+#endif
+
+constexpr uint64 ETHBRIDGE_MAX_ORDERS = ETHBRIDGE_ORDER_CAPACITY;
+constexpr uint64 ETHBRIDGE_MAX_MANAGERS = ETHBRIDGE_MANAGER_CAPACITY;
+
+static_assert(ETHBRIDGE_MAX_ORDERS >= 2 && (ETHBRIDGE_MAX_ORDERS & (ETHBRIDGE_MAX_ORDERS - 1)) == 0,
+    "ETHBRIDGE_ORDER_CAPACITY must be a power of 2");
+static_assert(ETHBRIDGE_MAX_MANAGERS >= 2 && (ETHBRIDGE_MAX_MANAGERS & (ETHBRIDGE_MAX_MANAGERS - 1)) == 0,
+    "ETHBRIDGE_MANAGER_CAPACITY must be a power of 2");
+
+constexpr uint64 ETHBRIDGE_ORDER_SCAN_WINDOW = 256;            // Order IDs examined per getOrders call
+constexpr uint64 ETHBRIDGE_SHARD_BITS = 6;
+constexpr uint64 ETHBRIDGE_SHARD_COUNT = 1ULL << ETHBRIDGE_SHARD_BITS; // Order-ID shards the admin can assign to managers
+constexpr uint64 ETHBRIDGE_EXPIRY_PER_TICK = 16;               // Expired orders closed per tick
+constexpr uint64 ETHBRIDGE_SWEEP_BLOCK_BITS = 6;
+constexpr uint64 ETHBRIDGE_SWEEP_BLOCK = (ETHBRIDGE_MAX_ORDERS >> ETHBRIDGE_SWEEP_BLOCK_BITS) ? (1ULL << ETHBRIDGE_SWEEP_BLOCK_BITS) : ETHBRIDGE_MAX_ORDERS; // Slots per retirement sweep block
+constexpr uint64 ETHBRIDGE_SWEEP_BLOCKS = (ETHBRIDGE_MAX_ORDERS >> ETHBRIDGE_SWEEP_BLOCK_BITS) ? (ETHBRIDGE_MAX_ORDERS >> ETHBRIDGE_SWEEP_BLOCK_BITS) : 1; // Sweep blocks in the order table
+constexpr uint64 ETHBRIDGE_MAX_STATE_SIZE = 1073741824;        // Contract state budget (1 GiB)
+
+// Log verbosity, overridable at build time. Errors are always logged.
+#ifndef ETHBRIDGE_LOG_LEVEL
+#define ETHBRIDGE_LOG_LEVEL 1
+#endif
+
+constexpr uint8 ETHBRIDGE_LOG_ERRORS = 0;                      // Errors only
+constexpr uint8 ETHBRIDGE_LOG_STATE = 1;                       // Errors plus one record per state change
+constexpr uint8 ETHBRIDGE_LOG_VERBOSE = 2;                     // Also redundant success and balance records
+
+// Completion latency histogram: bucket 0 holds orders completed in their
+// creation tick, bucket b holds latencies in [2^(b-1), 2^b) ticks and the
+// last bucket everything above
+constexpr uint64 ETHBRIDGE_LATENCY_BUCKETS = 16;
+
+// Per-tick batch commitments over completed Qubic -> Ethereum orders
+constexpr uint64 ETHBRIDGE_BATCH_TREE_DEPTH = 16;              // Up to 2^16 - 1 orders per batch
+constexpr uint64 ETHBRIDGE_BATCH_HISTORY = 64;                 // Finalized batches kept queryable
+
+// BridgeOrder::flags layout
+constexpr uint8 ETHBRIDGE_ORDER_STATUS_MASK = 0x03;            // Bits 0-1: order status
+constexpr uint8 ETHBRIDGE_ORDER_CREATED = 0;
+constexpr uint8 ETHBRIDGE_ORDER_COMPLETED = 1;
+constexpr uint8 ETHBRIDGE_ORDER_REFUNDED = 2;
+constexpr uint8 ETHBRIDGE_ORDER_EMPTY = 3;                     // Vacant slot
+constexpr uint8 ETHBRIDGE_ORDER_TYPE_MASK = 0x0C;              // Bits 2-3: order type
+constexpr uint8 ETHBRIDGE_ORDER_TO_ETHEREUM = 0x10;            // Bit 4: Qubic -> Ethereum
+constexpr uint8 ETHBRIDGE_ORDER_DEPOSIT_BOUND = 0x20;          // Bit 5: amount was deposited with the order
+constexpr uint8 ETHBRIDGE_ORDER_EXPIRED = 0x40;                // Bit 6: refunded by the expiry sweep without a payout
+
 struct ETHBRIDGE2
 {
 };
@@ -10,14 +65,69 @@ struct ETHBRIDGE2
 struct ETHBRIDGE : public ContractBase {
 
 public:
-    // Bridge Order Structure
+    // Bridge Order Structure. This is the logical order record assembled by
+    // loadOrder; the contract state keeps its fields in per-field arrays.
+    // The EVM address is stored as its 20 meaningful bytes: the first 20
+    // bytes of the id passed to createOrder.
     struct BridgeOrder {
         uint64 orderId;                      // Unique ID for the order
+        uint64 amount;                       // Amount to transfer
+        id qubicSender;                      // Sender address on Qubic
+        uint64 ethAddressLow;                // Destination EVM address, bytes 0-7
+        uint64 ethAddressMid;                // Destination EVM address, bytes 8-15
+        uint32 ethAddressHigh;               // Destination EVM address, bytes 16-19
+        uint32 createdTick;                  // Tick in which the order was created
+        uint32 finishedTick;                 // Tick in which the order was completed or refunded (0 while pending)
+        uint16 finishedEpoch;                // Epoch in which the order was completed or refunded
+        uint8 flags;                         // Status, type and direction (ETHBRIDGE_ORDER_* bits)
+        uint8 reserved;
+    };
+
+    // Cold part of a stored order: who sent it and where it goes
+    struct OrderParties {
         id qubicSender;                      // Sender address on Qubic
+        uint64 ethAddressLow;                // Destination EVM address, bytes 0-7
+        uint64 ethAddressMid;                // Destination EVM address, bytes 8-15
+        uint32 ethAddressHigh;               // Destination EVM address, bytes 16-19
+    };
+
+    // Audit summary of the finished orders removed from the order table
+    struct RetiredOrdersSummary {
+        uint64 orderCount;                   // Orders retired so far
+        uint64 completedAmount;              // Sum of retired completed order amounts
+        uint64 refundedAmount;               // Sum of retired refunded order amounts that were paid back
+        uint64 lastOrderId;                  // Highest orderId retired so far
+        uint16 lastEpoch;                    // Epoch of the last retirement pass that retired orders
+        id digest;                           // K12 chain over every retired BridgeOrder
+    };
+
+    // Commitment to the Qubic -> Ethereum orders completed in one tick. The
+    // root is a K12 Merkle tree of depth ETHBRIDGE_BATCH_TREE_DEPTH over
+    // BatchLeaf records in completion order, padded with zero subtrees.
+    struct BatchRecord {
+        uint64 batchId;                      // Sequence number, starting at 0
+        uint32 tick;                         // Tick in which the orders were completed
+        uint32 orderCount;                   // Number of leaves
+        uint64 firstOrderId;                 // Lowest orderId in the batch
+        uint64 lastOrderId;                  // Highest orderId in the batch
+        uint64 totalAmount;                  // Sum of the order amounts
+        id root;                             // Merkle root
+    };
+
+    // Leaf of a batch tree, hashed with K12
+    struct BatchLeaf {
+        uint64 orderId;
+        uint64 amount;
+        uint64 ethAddressLow;                // Destination EVM address, bytes 0-7
+        uint64 ethAddressMid;                // Destination EVM address, bytes 8-15
+        uint32 ethAddressHigh;               // Destination EVM address, bytes 16-19
+        uint32 reserved;
+    };
+
+    // Single entry of a createOrders batch
+    struct OrderRequest {
         id ethAddress;                       // Destination Ethereum address
         uint64 amount;                       // Amount to transfer
-        uint8 orderType;                     // Type of order (e.g., mint, transfer)
-        uint8 status;                        // Order status (e.g., Created, Pending, Refunded)
         bit fromQubicToEthereum;             // Direction of transfer
     };
 
@@ -26,10 +136,24 @@ public:
         id ethAddress;
         uint64 amount;
         bit fromQubicToEthereum;
+        bit attachDeposit;                   // Take the invocation reward beyond the fee as this order's deposit
+        uint64 priorityFee;                  // Paid on top of transactionFee to rank the order in the priority lane
     };
 
     struct createOrder_output {
         uint8 status;
+        uint64 orderId;                      // ID assigned to the new order
+    };
+
+    struct createOrders_input {
+        array<OrderRequest, 16> orders;      // Orders to create
+        uint8 orderCount;                    // Number of used entries in orders
+    };
+
+    struct createOrders_output {
+        uint8 status;
+        uint64 firstOrderId;                 // IDs firstOrderId .. firstOrderId + orderCount - 1 were allocated
+        uint8 orderCount;
     };
 
     struct setAdmin_input {
@@ -78,6 +202,18 @@ public:
         uint8 status;
     };
 
+    struct completeOrders_input {
+        array<uint64, 32> orderIds;          // Orders to complete
+        uint8 orderCount;                    // Number of used entries in orderIds
+    };
+
+    struct completeOrders_output {
+        uint8 status;                        // 0 = Batch processed, 1 = Unauthorized, 2 = Invalid orderCount
+        array<uint8, 32> orderStatus;        // Per-order completeOrder status code
+        uint8 completedCount;                // Orders completed successfully
+        uint64 completedAmount;              // Sum of the completed order amounts
+    };
+
     struct refundOrder_input {
         uint64 orderId;
     };
@@ -86,6 +222,18 @@ public:
         uint8 status;
     };
 
+    struct refundOrders_input {
+        array<uint64, 64> orderIds;          // Orders to refund
+        uint8 orderCount;                    // Number of used entries in orderIds
+    };
+
+    struct refundOrders_output {
+        uint8 status;                        // 0 = Batch processed, 1 = Unauthorized, 2 = Invalid orderCount
+        array<uint8, 64> orderStatus;        // Per-order refundOrder status code
+        uint8 refundedCount;                 // Orders refunded successfully
+        uint64 totalReleased;                // Sum of the refunded order amounts
+    };
+
     struct transferToContract_input {
         uint64 amount;
     };
@@ -102,6 +250,11 @@ public:
         uint64 amount;                       // Amount as uint64
         array<uint8, 64> memo;               // Notes or metadata
         uint32 sourceChain;                  // Source chain identifier
+        uint8 status;                        // Order status (0 = Created, 1 = Completed, 2 = Refunded)
+        bit fromQubicToEthereum;             // Direction of transfer
+        uint32 createdTick;                  // Tick in which the order was created
+        uint32 finishedTick;                 // Tick in which the order was completed or refunded (0 while pending)
+        uint64 priorityFee;                  // Fee paid above transactionFee
     };
 
     struct getOrder_input {
@@ -114,6 +267,177 @@ public:
         OrderResponse order;                 // Updated response format
     };
 
+    struct getOrders_input {
+        uint64 startOrderId;                 // First order ID to examine
+        uint64 maxCount;                     // Maximum number of orders to return (0 = as many as fit)
+    };
+
+    struct getOrders_output {
+        array<OrderResponse, 16> orders;
+        uint64 count;                        // Number of used entries in orders
+        uint64 nextOrderId;                  // Cursor for the next call; equals the next unassigned ID once caught up
+    };
+
+    struct getOrdersByIds_input {
+        array<uint64, 32> orderIds;
+        uint8 orderCount;                    // Number of used entries in orderIds
+    };
+
+    struct getOrdersByIds_output {
+        uint8 status;                        // 0 = success, 1 = invalid orderCount
+        array<OrderResponse, 32> orders;     // orders[i] belongs to orderIds[i]
+        array<bit, 32> found;                // Whether orderIds[i] is a stored order
+        uint8 foundCount;
+    };
+
+    struct getPendingOrders_input {
+        uint64 maxCount;                     // Maximum number of orders to return (0 = as many as fit)
+        bit fromQubicToEthereum;             // Queue to read
+        bit continueAfter;                   // Resume after afterOrderId instead of the oldest order
+        uint64 afterOrderId;
+    };
+
+    struct getPendingOrders_output {
+        array<OrderResponse, 16> orders;     // Oldest first
+        uint64 count;                        // Number of used entries in orders
+        uint64 totalPending;                 // Orders currently pending in this direction
+    };
+
+    struct getNextOrdersByPriority_input {
+        uint64 maxCount;                     // Maximum number of orders to return (0 = as many as fit)
+    };
+
+    struct getNextOrdersByPriority_output {
+        array<OrderResponse, 16> orders;     // Highest priority fee first, oldest first on equal fees
+        uint64 count;                        // Number of used entries in orders
+        uint64 totalPending;                 // Orders currently pending in both directions
+    };
+
+    struct getPendingOrdersForManager_input {
+        id manager;                          // Manager whose shards are listed
+        uint64 maxCount;                     // Maximum number of orders to return (0 = as many as fit)
+        bit fromQubicToEthereum;             // Queue to read
+        bit includeUnassigned;               // Also list orders of shards without an owner
+        bit continueAfter;                   // Resume after afterOrderId instead of the oldest order
+        uint64 afterOrderId;
+    };
+
+    struct getPendingOrdersForManager_output {
+        array<OrderResponse, 16> orders;     // Oldest first
+        uint64 count;                        // Number of used entries in orders
+        uint64 afterOrderId;                 // Last examined order; pass back with continueAfter to go on
+        bit reachedEnd;                      // The whole queue has been examined
+    };
+
+    struct setShardOwner_input {
+        uint64 shard;                        // Shard index, below ETHBRIDGE_SHARD_COUNT
+        id manager;                          // Owning manager, or NULL_ID to let any manager handle the shard
+    };
+
+    struct setShardOwner_output {
+        uint8 status;
+    };
+
+    struct getShardOwners_input {
+    };
+
+    struct getShardOwners_output {
+        array<id, ETHBRIDGE_SHARD_COUNT> owners;     // NULL_ID = any manager
+    };
+
+    struct getOrdersBySender_input {
+        id sender;                           // qubicSender to list
+        uint64 beforeOrderId;                // Only return orders with a lower ID (0 = start at the newest)
+        uint64 maxCount;                     // Maximum number of orders to return (0 = as many as fit)
+    };
+
+    struct getOrdersBySender_output {
+        array<OrderResponse, 16> orders;     // Newest first
+        uint64 count;                        // Number of used entries in orders
+        uint64 nextOrderId;                  // beforeOrderId for the next page, 0 when there is none
+        uint64 totalOrders;                  // Orders of this sender still stored
+    };
+
+    struct setRetentionEpochs_input {
+        uint16 epochs;                       // Epochs a finished order stays queryable before retirement
+    };
+
+    struct setRetentionEpochs_output {
+        uint8 status;
+    };
+
+    struct setPayoutMode_input {
+        bit deferred;                        // Queue Ethereum -> Qubic payouts for END_TICK instead of paying inline
+        uint64 transfersPerTick;             // Maximum number of payout transfers END_TICK may issue
+    };
+
+    struct setPayoutMode_output {
+        uint8 status;
+    };
+
+    struct setOrderTimeout_input {
+        uint32 timeoutTicks;                 // Pending Qubic -> Ethereum orders older than this expire automatically (0 = never)
+    };
+
+    struct setOrderTimeout_output {
+        uint8 status;
+    };
+
+    struct getPayoutQueue_input {
+    };
+
+    struct getPayoutQueue_output {
+        bit deferred;
+        uint64 transfersPerTick;
+        uint64 queuedRecipients;             // Distinct recipients waiting for a payout
+        uint64 queuedAmount;                 // Total amount waiting to be paid out
+    };
+
+    struct getBatch_input {
+        uint64 batchId;
+    };
+
+    struct getBatch_output {
+        uint8 status;                        // 0 = found, 1 = not finalized yet or no longer kept
+        BatchRecord batch;
+        uint64 batchCount;                   // Number of batches finalized so far
+    };
+
+    struct getRetiredSummary_input {
+    };
+
+    struct getRetiredSummary_output {
+        RetiredOrdersSummary summary;
+        uint16 retentionEpochs;
+    };
+
+    struct getStats_input {
+    };
+
+    struct getStats_output {
+        array<uint64, 8> orderCounts;        // Stored orders, index = status << 1 | (fromQubicToEthereum ? 1 : 0)
+        array<uint64, 2> pendingAmounts;     // Amount of pending orders, index = fromQubicToEthereum ? 1 : 0
+        array<uint64, 16> errorCounts;       // Occurrences per EthBridgeError code
+        uint64 transactionFee;
+        uint64 lockedTokens;
+        uint64 totalReceivedTokens;
+        uint64 orderDeposits;
+        uint64 occupiedSlots;
+        uint64 freeSlots;
+        uint64 expiredOrders;                // Orders closed automatically after orderTimeoutTicks
+        uint32 orderTimeoutTicks;
+    };
+
+    struct getLatencyHistogram_input {
+    };
+
+    struct getLatencyHistogram_output {
+        // Completed orders per latency bucket, index = (fromQubicToEthereum ? ETHBRIDGE_LATENCY_BUCKETS : 0) + bucket
+        array<uint64, 2 * ETHBRIDGE_LATENCY_BUCKETS> buckets;
+        array<uint64, 2> totalLatencyTicks;  // Sum of create -> complete latencies per direction
+        array<uint64, 2> completedCount;     // Orders recorded in the histogram per direction
+    };
+
     struct getAdminID_input {
     };
 
@@ -144,6 +468,15 @@ public:
         char _terminator;
     };
 
+    // Admin setting change, one record per successful set* call
+    struct ConfigLogger {
+        uint32 _contractIndex;
+        uint32 _setting;         // EthBridgeSetting
+        id _address;             // Address the setting applies to (shard owner), else NULL_ID
+        uint64 _value;           // New value, or the shard index for shardOwnerChanged
+        char _terminator;
+    };
+
     struct TokensLogger {
         uint32 _contractIndex;
         uint64 _lockedTokens;   // Balance tokens locked
@@ -151,6 +484,53 @@ public:
         char _terminator;
     };
 
+    // Order lifecycle event, one record per created, completed or refunded
+    // order and per deposit, carrying the full order data
+    struct OrderEventLogger {
+        uint32 _contractIndex;
+        uint32 _eventCode;       // EthBridgeEvent
+        uint64 _orderId;         // Order ID (0 for plain deposits)
+        id _sender;              // qubicSender of the order, or depositor
+        id _destination;         // EVM destination (first 20 bytes), or the contract for deposits
+        uint64 _amount;
+        uint32 _tick;            // Tick in which the event happened
+        bit _fromQubicToEthereum;
+        char _terminator;
+    };
+
+    // Finalized batch commitment, one record per batch
+    struct BatchLogger {
+        uint32 _contractIndex;
+        uint32 _eventCode;       // EthBridgeEvent::batchCommitted
+        uint64 _batchId;
+        uint64 _firstOrderId;
+        uint64 _lastOrderId;
+        uint64 _totalAmount;
+        id _root;
+        uint32 _tick;
+        uint32 _orderCount;
+        char _terminator;
+    };
+
+    // Enum for order event codes
+    enum EthBridgeEvent {
+        orderCreated = 1,
+        orderCompleted = 2,
+        orderRefunded = 3,
+        deposit = 4,
+        batchCommitted = 5,
+        orderExpired = 6
+    };
+
+    // Enum for ConfigLogger setting codes
+    enum EthBridgeSetting {
+        retentionEpochsChanged = 1,
+        payoutsInline = 2,
+        payoutsDeferred = 3,
+        orderTimeoutChanged = 4,
+        shardOwnerChanged = 5
+    };
+
     // Enum for error codes
     enum EthBridgeError {
         onlyManagersCanCompleteOrders = 1,
@@ -159,20 +539,72 @@ public:
         orderNotFound = 4,
         invalidOrderState = 5,
         insufficientLockedTokens = 6,
-        transferFailed = 7
+        transferFailed = 7,
+        orderTableFull = 8,
+        invalidBatchSize = 9,
+        invalidDeposit = 10,
+        managerAlreadyExists = 11,
+        managerLimitReached = 12,
+        wrongShard = 13,
+        invalidEthAddress = 14,
+        indexFull = 15
     };
 
 
-private:
+protected:
     // Contract State
-    array<BridgeOrder, 256> orders;      // Storage for orders (fixed size)
+    // Order table, stored as one array per field so that sweeps over every
+    // slot only stream the hot fields (flags, orderId, amount, finish epoch)
+    array<uint64, ETHBRIDGE_MAX_ORDERS> orderIds;              // BridgeOrder::orderId per slot
+    array<uint64, ETHBRIDGE_MAX_ORDERS> orderAmounts;          // BridgeOrder::amount per slot
+    array<uint8, ETHBRIDGE_MAX_ORDERS> orderFlags;             // BridgeOrder::flags per slot
+    array<uint16, ETHBRIDGE_MAX_ORDERS> orderFinishedEpochs;   // BridgeOrder::finishedEpoch per slot
+    array<uint32, ETHBRIDGE_MAX_ORDERS> orderCreatedTicks;     // BridgeOrder::createdTick per slot
+    array<uint32, ETHBRIDGE_MAX_ORDERS> orderFinishedTicks;    // BridgeOrder::finishedTick per slot
+    array<OrderParties, ETHBRIDGE_MAX_ORDERS> orderParties;    // Cold sender/destination fields per slot
+    array<uint8, ETHBRIDGE_SWEEP_BLOCKS> finishedPerBlock;     // Completed or refunded orders per sweep block
+    HashMap<uint64, uint64, ETHBRIDGE_MAX_ORDERS> orderIndex;  // orderId -> slot in the order arrays
+    array<uint64, ETHBRIDGE_MAX_ORDERS> freeSlots;             // Stack of vacant slots in the order arrays
+    uint64 freeSlotCount;                          // Number of entries in freeSlots
     uint64 nextOrderId;                            // Counter for order IDs
     uint64 lockedTokens;                           // Total locked tokens in the contract (balance)
     uint64 transactionFee;                         // Fee for creating an order
     id admin;                                      // Admin address
-    array<id, 16> managers;            // Managers list
+    HashSet<id, ETHBRIDGE_MAX_MANAGERS> managers;  // Managers set
     uint64 totalReceivedTokens;                    // Total tokens received
+    uint64 orderDeposits;                          // Deposits bound to pending orders
     uint32 sourceChain;                            // Source chain identifier
+    array<sint64, ETHBRIDGE_MAX_ORDERS> pendingPrev; // Previous slot in the pending queue of the order
+    array<sint64, ETHBRIDGE_MAX_ORDERS> pendingNext; // Next slot in the pending queue of the order
+    array<sint64, 2> pendingHead;                  // Oldest pending slot per direction
+    array<sint64, 2> pendingTail;                  // Newest pending slot per direction
+    array<uint64, 2> pendingCount;                 // Pending orders per direction
+    Collection<uint64, ETHBRIDGE_MAX_ORDERS> senderOrders; // Slots per qubicSender, prioritized by orderId
+    array<uint64, 8> orderCounts;                  // Stored orders per (status << 1 | toEthereum)
+    array<uint64, 2> pendingAmounts;               // Amount of pending orders per direction
+    array<uint64, 16> errorCounts;                 // Occurrences per EthBridgeError
+    array<uint64, 2 * ETHBRIDGE_LATENCY_BUCKETS> latencyHistogram; // Completion latency buckets per direction
+    array<uint64, 2> totalLatencyTicks;            // Sum of completion latencies per direction
+    array<uint64, 2> completedCount;               // Completions recorded in latencyHistogram per direction
+    bit deferPayouts;                              // Settle Ethereum -> Qubic payouts in END_TICK
+    uint64 payoutsPerTick;                         // Payout transfer budget per tick
+    HashMap<id, uint64, ETHBRIDGE_MAX_ORDERS> queuedPayouts; // Amount owed per queued recipient
+    array<id, ETHBRIDGE_MAX_ORDERS> payoutQueue;   // Ring of recipients in queuedPayouts, oldest first
+    uint64 payoutQueueHead;                        // Ring index of the oldest queued recipient
+    uint64 payoutQueueCount;                       // Number of recipients in payoutQueue
+    uint64 queuedPayoutTotal;                      // Sum of queuedPayouts, still held by the contract
+    BatchRecord openBatch;                         // Batch of the current tick, root not yet computed
+    array<id, ETHBRIDGE_BATCH_TREE_DEPTH> batchBranch;     // Left siblings on the path of the next leaf
+    array<id, ETHBRIDGE_BATCH_TREE_DEPTH> batchZeroHashes; // Roots of empty subtrees per height
+    array<BatchRecord, ETHBRIDGE_BATCH_HISTORY> batches;   // Ring of finalized batches, by batchId
+    uint64 batchCount;                             // Number of finalized batches
+    array<uint64, ETHBRIDGE_MAX_ORDERS> orderPriorityFees; // Fee paid above transactionFee per slot
+    Collection<uint64, ETHBRIDGE_MAX_ORDERS> priorityOrders; // Pending slots under SELF, prioritized by priorityKey
+    array<id, ETHBRIDGE_SHARD_COUNT> shardOwners;  // Manager owning each order-ID shard (NULL_ID = any manager)
+    uint32 orderTimeoutTicks;                      // Age in ticks after which pending Qubic -> Ethereum orders expire (0 = never)
+    uint64 expiredOrders;                          // Orders closed by the expiry sweep
+    uint16 retentionEpochs;                        // Epochs before finished orders are retired
+    RetiredOrdersSummary retired;                  // Audit trail of retired orders
 
     // Internal methods for admin/manager permissions        
     typedef id isAdmin_input;
@@ -186,20 +618,263 @@ private:
     typedef bit isManager_output;
 
     PRIVATE_FUNCTION(isManager)
-        for (uint64 i = 0; i < state.managers.capacity(); ++i) {
-            if (state.managers.get(i) == input) {
-                output = true;
-                return;
-            }
+        output = state.managers.contains(input);
+    _
+
+    // Counts an error in errorCounts and logs it
+    typedef EthBridgeLogger logError_input;
+
+    struct logError_output {
+    };
+
+    PRIVATE_PROCEDURE(logError)
+        state.errorCounts.set(input._errorCode, state.errorCounts.get(input._errorCode) + 1);
+        LOG_INFO(input);
+    _
+
+    // Assembles the full order record stored in a slot
+    struct loadOrder_input {
+        uint64 slot;
+    };
+
+    struct loadOrder_output {
+        BridgeOrder order;
+    };
+
+    struct loadOrder_locals {
+        OrderParties parties;
+    };
+
+    PRIVATE_FUNCTION_WITH_LOCALS(loadOrder)
+        locals.parties = state.orderParties.get(input.slot);
+        output.order.orderId = state.orderIds.get(input.slot);
+        output.order.amount = state.orderAmounts.get(input.slot);
+        output.order.qubicSender = locals.parties.qubicSender;
+        output.order.ethAddressLow = locals.parties.ethAddressLow;
+        output.order.ethAddressMid = locals.parties.ethAddressMid;
+        output.order.ethAddressHigh = locals.parties.ethAddressHigh;
+        output.order.createdTick = state.orderCreatedTicks.get(input.slot);
+        output.order.finishedTick = state.orderFinishedTicks.get(input.slot);
+        output.order.finishedEpoch = state.orderFinishedEpochs.get(input.slot);
+        output.order.flags = state.orderFlags.get(input.slot);
+        output.order.reserved = 0;
+    _
+
+    // Shard of an order ID (Fibonacci hashing, so consecutive IDs spread
+    // evenly over the shards)
+    typedef uint64 orderShard_input;
+    typedef uint64 orderShard_output;
+
+    PRIVATE_FUNCTION(orderShard)
+        output = (input * 0x9E3779B97F4A7C15ULL) >> (64 - ETHBRIDGE_SHARD_BITS);
+    _
+
+    // Rank of a pending order in the priority lane: the priority fee (capped
+    // at 2^31 - 1) in the high half, and the inverted low 32 bits of the
+    // orderId in the low half, so that older orders win ties. Keys are unique.
+    struct priorityKey_input {
+        uint64 slot;
+    };
+
+    typedef sint64 priorityKey_output;
+
+    struct priorityKey_locals {
+        uint64 fee;
+    };
+
+    PRIVATE_FUNCTION_WITH_LOCALS(priorityKey)
+        locals.fee = state.orderPriorityFees.get(input.slot);
+        if (locals.fee > 0x7FFFFFFF) {
+            locals.fee = 0x7FFFFFFF;
+        }
+        output = (sint64)((locals.fee << 32) | (0xFFFFFFFFULL - (state.orderIds.get(input.slot) & 0xFFFFFFFFULL)));
+    _
+
+    // Pending queues: one FIFO of status 0 orders per direction, linked
+    // through slot indices (index 1 = Qubic -> Ethereum). Pending orders of
+    // both directions are also kept in the priorityOrders lane.
+    struct linkPending_input {
+        uint64 slot;
+        bit fromQubicToEthereum;
+    };
+
+    struct linkPending_output {
+    };
+
+    struct linkPending_locals {
+        uint64 queue;
+        sint64 tail;
+    };
+
+    PRIVATE_PROCEDURE_WITH_LOCALS(linkPending)
+        locals.queue = input.fromQubicToEthereum ? 1 : 0;
+        locals.tail = state.pendingTail.get(locals.queue);
+
+        state.pendingPrev.set(input.slot, locals.tail);
+        state.pendingNext.set(input.slot, NULL_INDEX);
+        if (locals.tail == NULL_INDEX) {
+            state.pendingHead.set(locals.queue, input.slot);
+        }
+        else {
+            state.pendingNext.set(locals.tail, input.slot);
+        }
+        state.pendingTail.set(locals.queue, input.slot);
+        state.pendingCount.set(locals.queue, state.pendingCount.get(locals.queue) + 1);
+    _
+
+    typedef linkPending_input unlinkPending_input;
+    typedef linkPending_output unlinkPending_output;
+
+    struct unlinkPending_locals {
+        uint64 queue;
+        sint64 prev;
+        sint64 next;
+        priorityKey_input keyInput;
+        sint64 key;
+        sint64 elementIndex;
+    };
+
+    PRIVATE_PROCEDURE_WITH_LOCALS(unlinkPending)
+        locals.queue = input.fromQubicToEthereum ? 1 : 0;
+        locals.prev = state.pendingPrev.get(input.slot);
+        locals.next = state.pendingNext.get(input.slot);
+
+        if (locals.prev == NULL_INDEX) {
+            state.pendingHead.set(locals.queue, locals.next);
+        }
+        else {
+            state.pendingNext.set(locals.prev, locals.next);
+        }
+        if (locals.next == NULL_INDEX) {
+            state.pendingTail.set(locals.queue, locals.prev);
+        }
+        else {
+            state.pendingPrev.set(locals.next, locals.prev);
+        }
+        state.pendingPrev.set(input.slot, NULL_INDEX);
+        state.pendingNext.set(input.slot, NULL_INDEX);
+        state.pendingCount.set(locals.queue, state.pendingCount.get(locals.queue) - 1);
+
+        locals.keyInput.slot = input.slot;
+        CALL(priorityKey, locals.keyInput, locals.key);
+        locals.elementIndex = state.priorityOrders.headIndex(SELF, locals.key);
+        if (locals.elementIndex != NULL_INDEX && state.priorityOrders.element(locals.elementIndex) == input.slot) {
+            state.priorityOrders.remove(locals.elementIndex);
+        }
+    _
+
+    // Stores a new order in a vacant slot. The caller must have checked that
+    // a slot is available.
+    struct insertOrder_input {
+        id qubicSender;
+        id ethAddress;
+        uint64 amount;
+        bit fromQubicToEthereum;
+        bit depositBound;
+        uint64 priorityFee;
+    };
+
+    struct insertOrder_output {
+        uint64 orderId;
+    };
+
+    struct insertOrder_locals {
+        EthBridgeLogger log;
+        logError_output errorLogged;
+        OrderEventLogger event;
+        uint64 statsIndex;
+        uint64 orderId;
+        uint8 flags;
+        OrderParties parties;
+        uint64 slot;
+        linkPending_input pendingInput;
+        linkPending_output pendingOutput;
+        priorityKey_input keyInput;
+        sint64 key;
+        sint64 senderIndex;
+        sint64 priorityIndex;
+    };
+
+    PRIVATE_PROCEDURE_WITH_LOCALS(insertOrder)
+        // Create the order
+        locals.orderId = state.nextOrderId++;
+        locals.parties.qubicSender = input.qubicSender;
+        locals.parties.ethAddressLow = input.ethAddress.u64._0;
+        locals.parties.ethAddressMid = input.ethAddress.u64._1;
+        locals.parties.ethAddressHigh = input.ethAddress.u32._4;
+        locals.flags = ETHBRIDGE_ORDER_CREATED; // Default order type 0
+        if (input.fromQubicToEthereum) {
+            locals.flags |= ETHBRIDGE_ORDER_TO_ETHEREUM;
+        }
+        if (input.depositBound) {
+            locals.flags |= ETHBRIDGE_ORDER_DEPOSIT_BOUND;
+            state.orderDeposits += input.amount;
+        }
+
+        // Store the order in the most recently freed slot
+        locals.slot = state.freeSlots.get(--state.freeSlotCount);
+        state.orderIds.set(locals.slot, locals.orderId);
+        state.orderAmounts.set(locals.slot, input.amount);
+        state.orderFlags.set(locals.slot, locals.flags);
+        state.orderFinishedEpochs.set(locals.slot, 0);
+        state.orderCreatedTicks.set(locals.slot, qpi.tick());
+        state.orderFinishedTicks.set(locals.slot, 0);
+        state.orderPriorityFees.set(locals.slot, input.priorityFee);
+        state.orderParties.set(locals.slot, locals.parties);
+        state.orderIndex.set(locals.orderId, locals.slot);
+
+        locals.pendingInput.slot = locals.slot;
+        locals.pendingInput.fromQubicToEthereum = input.fromQubicToEthereum;
+        CALL(linkPending, locals.pendingInput, locals.pendingOutput);
+
+        // Both collections have room for every slot, so an add only fails if
+        // their PoV tables are full. The order stays valid and can still be
+        // read by ID, it is just missing from that index.
+        locals.keyInput.slot = locals.slot;
+        CALL(priorityKey, locals.keyInput, locals.key);
+        locals.senderIndex = state.senderOrders.add(input.qubicSender, locals.slot, locals.orderId);
+        locals.priorityIndex = state.priorityOrders.add(SELF, locals.slot, locals.key);
+        if (locals.senderIndex == NULL_INDEX || locals.priorityIndex == NULL_INDEX) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::indexFull,
+                locals.orderId,
+                input.amount,
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+        }
+
+        locals.statsIndex = (ETHBRIDGE_ORDER_CREATED << 1) | (input.fromQubicToEthereum ? 1 : 0);
+        state.orderCounts.set(locals.statsIndex, state.orderCounts.get(locals.statsIndex) + 1);
+        locals.statsIndex = input.fromQubicToEthereum ? 1 : 0;
+        state.pendingAmounts.set(locals.statsIndex, state.pendingAmounts.get(locals.statsIndex) + input.amount);
+
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_STATE) {
+            locals.event = OrderEventLogger{
+                CONTRACT_INDEX,
+                EthBridgeEvent::orderCreated,
+                locals.orderId,
+                input.qubicSender,
+                id(locals.parties.ethAddressLow, locals.parties.ethAddressMid, locals.parties.ethAddressHigh, 0),
+                input.amount,
+                qpi.tick(),
+                input.fromQubicToEthereum,
+                0
+            };
+            LOG_INFO(locals.event);
         }
-    output = false;
+
+        output.orderId = locals.orderId;
     _
 
 public:
     // Create a new order and lock tokens
     struct createOrder_locals {
-        BridgeOrder newOrder;
         EthBridgeLogger log;
+        logError_output errorLogged;
+        insertOrder_input insertInput;
+        insertOrder_output insertOutput;
     };
 
     PUBLIC_PROCEDURE_WITH_LOCALS(createOrder)
@@ -213,12 +888,34 @@ public:
                 input.amount,
                 0
             };
-            LOG_INFO(locals.log);
+            CALL(logError, locals.log, locals.errorLogged);
+            if (input.attachDeposit && qpi.invocationReward() > 0) {
+                qpi.transfer(qpi.invocator(), qpi.invocationReward());
+            }
             output.status = 1; // Error
             return;
         }
 
-        if (qpi.invocationReward() < state.transactionFee) {
+        // The EVM address must sit in the first 20 bytes of ethAddress; a
+        // right-aligned (bytes32) address would otherwise be truncated
+        if (input.ethAddress.u32._5 != 0 || input.ethAddress.u64._3 != 0) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::invalidEthAddress,
+                0,
+                input.amount,
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            if (input.attachDeposit && qpi.invocationReward() > 0) {
+                qpi.transfer(qpi.invocator(), qpi.invocationReward());
+            }
+            output.status = 5; // Error
+            return;
+        }
+
+        if (qpi.invocationReward() < state.transactionFee
+            || qpi.invocationReward() - state.transactionFee < input.priorityFee) {
             locals.log = EthBridgeLogger{
                 CONTRACT_INDEX,
                 EthBridgeError::insufficientTransactionFee,
@@ -226,88 +923,438 @@ public:
                 input.amount,
                 0
             };
-            LOG_INFO(locals.log);
+            CALL(logError, locals.log, locals.errorLogged);
+            if (input.attachDeposit && qpi.invocationReward() > 0) {
+                qpi.transfer(qpi.invocator(), qpi.invocationReward());
+            }
             output.status = 2; // Error
             return;
         }
 
-        // Create the order
-        locals.newOrder.orderId = state.nextOrderId++;
-        locals.newOrder.qubicSender = qpi.invocator();
-        locals.newOrder.ethAddress = input.ethAddress;
-        locals.newOrder.amount = input.amount;
-        locals.newOrder.orderType = 0; // Default order type
-        locals.newOrder.status = 0; // Created
-        locals.newOrder.fromQubicToEthereum = input.fromQubicToEthereum;
-
-        // Store the order
-        for (uint64 i = 0; i < state.orders.capacity(); ++i) {
-            if (state.orders.get(i).status == 255) { // Empty slot
-                state.orders.set(i, locals.newOrder);
+        // Only Qubic -> Ethereum orders hold tokens on this side, and the
+        // deposit must cover the whole amount
+        if (input.attachDeposit
+            && (!input.fromQubicToEthereum || qpi.invocationReward() - state.transactionFee - input.priorityFee < input.amount)) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::invalidDeposit,
+                0,
+                input.amount,
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            qpi.transfer(qpi.invocator(), qpi.invocationReward());
+            output.status = 4; // Error
+            return;
+        }
 
-                locals.log = EthBridgeLogger{
-                    CONTRACT_INDEX,
-                    0,
-                    locals.newOrder.orderId,
-                    input.amount,
-                    0
-                };
-                LOG_INFO(locals.log);
-                output.status = 0; // Success
-                return;
+        if (state.freeSlotCount == 0) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::orderTableFull,
+                0,
+                input.amount,
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            if (input.attachDeposit && qpi.invocationReward() > 0) {
+                qpi.transfer(qpi.invocator(), qpi.invocationReward());
             }
+            output.status = 3; // Error
+            return;
+        }
+
+        locals.insertInput.qubicSender = qpi.invocator();
+        locals.insertInput.ethAddress = input.ethAddress;
+        locals.insertInput.amount = input.amount;
+        locals.insertInput.fromQubicToEthereum = input.fromQubicToEthereum;
+        locals.insertInput.depositBound = input.attachDeposit;
+        locals.insertInput.priorityFee = input.priorityFee;
+        CALL(insertOrder, locals.insertInput, locals.insertOutput);
+
+        // Return whatever was paid in beyond the fees and the deposit
+        if (input.attachDeposit && qpi.invocationReward() - state.transactionFee - input.priorityFee > input.amount) {
+            qpi.transfer(qpi.invocator(), qpi.invocationReward() - state.transactionFee - input.priorityFee - input.amount);
         }
+
+        output.status = 0; // Success
+        output.orderId = locals.insertOutput.orderId;
     _
 
-    // Retrieve an order
-    struct getOrder_locals {
+    // Create several orders with one fee check
+    struct createOrders_locals {
         EthBridgeLogger log;
-        BridgeOrder order;
-        OrderResponse orderResp;
+        logError_output errorLogged;
+        insertOrder_input insertInput;
+        insertOrder_output insertOutput;
+        OrderRequest request;
+        uint64 totalAmount;
+        uint64 i;
     };
 
-    PUBLIC_FUNCTION_WITH_LOCALS(getOrder)
-        for (uint64 i = 0; i < state.orders.capacity(); ++i) {
-            locals.order = state.orders.get(i);
-            if (locals.order.orderId == input.orderId && locals.order.status != 255) {
-                // Populate OrderResponse with BridgeOrder data
-                locals.orderResp.orderId = locals.order.orderId;
-                locals.orderResp.originAccount = locals.order.qubicSender;
-                locals.orderResp.destinationAccount = locals.order.ethAddress;
-                locals.orderResp.amount = locals.order.amount;
-                constexpr char placeholderMemo[64] = "Bridge transfer details"; // Placeholder for metadata
-                locals.orderResp.sourceChain = state.sourceChain;
+    PUBLIC_PROCEDURE_WITH_LOCALS(createOrders)
+        output.firstOrderId = 0;
+        output.orderCount = 0;
+
+        if (input.orderCount == 0 || input.orderCount > input.orders.capacity()) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::invalidBatchSize,
+                0,
+                input.orderCount,
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 4; // Error
+            return;
+        }
 
+        // The batch is all-or-nothing so the allocated IDs stay contiguous
+        locals.totalAmount = 0;
+        for (locals.i = 0; locals.i < input.orderCount; ++locals.i) {
+            locals.request = input.orders.get(locals.i);
+            if (locals.request.amount == 0) {
                 locals.log = EthBridgeLogger{
                     CONTRACT_INDEX,
-                    0, // No error
-                    locals.order.orderId,
-                    locals.order.amount,
+                    EthBridgeError::invalidAmount,
+                    locals.i, // Index of the offending entry
+                    locals.request.amount,
                     0
                 };
-                LOG_INFO(locals.log);
-
-                output.status = 0; // Success
-                output.order = locals.orderResp;
+                CALL(logError, locals.log, locals.errorLogged);
+                output.status = 1; // Error
                 return;
             }
-        }
-
-        // If order not found
-        locals.log = EthBridgeLogger{
-            CONTRACT_INDEX,
-            EthBridgeError::orderNotFound,
-            input.orderId,
-            0, // No amount involved
-            0
-        };
-        LOG_INFO(locals.log);
-        output.status = 1; // Error
+            if (locals.request.ethAddress.u32._5 != 0 || locals.request.ethAddress.u64._3 != 0) {
+                locals.log = EthBridgeLogger{
+                    CONTRACT_INDEX,
+                    EthBridgeError::invalidEthAddress,
+                    locals.i, // Index of the offending entry
+                    locals.request.amount,
+                    0
+                };
+                CALL(logError, locals.log, locals.errorLogged);
+                output.status = 5; // Error
+                return;
+            }
+            locals.totalAmount += locals.request.amount;
+        }
+
+        if (qpi.invocationReward() < state.transactionFee * input.orderCount) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::insufficientTransactionFee,
+                0,
+                locals.totalAmount,
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 2; // Error
+            return;
+        }
+
+        if (state.freeSlotCount < input.orderCount) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::orderTableFull,
+                0,
+                locals.totalAmount,
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 3; // Error
+            return;
+        }
+
+        locals.insertInput.qubicSender = qpi.invocator();
+        for (locals.i = 0; locals.i < input.orderCount; ++locals.i) {
+            locals.request = input.orders.get(locals.i);
+            locals.insertInput.ethAddress = locals.request.ethAddress;
+            locals.insertInput.amount = locals.request.amount;
+            locals.insertInput.fromQubicToEthereum = locals.request.fromQubicToEthereum;
+            locals.insertInput.depositBound = false;
+            locals.insertInput.priorityFee = 0;
+            CALL(insertOrder, locals.insertInput, locals.insertOutput);
+            if (locals.i == 0) {
+                output.firstOrderId = locals.insertOutput.orderId;
+            }
+        }
+        output.orderCount = input.orderCount;
+        output.status = 0; // Success
+    _
+
+private:
+    // Builds the public view of the order stored in a slot
+    struct readOrderSlot_input {
+        uint64 slot;
+    };
+
+    struct readOrderSlot_output {
+        OrderResponse order;
+    };
+
+    struct readOrderSlot_locals {
+        OrderParties parties;
+        uint8 flags;
+    };
+
+    PRIVATE_FUNCTION_WITH_LOCALS(readOrderSlot)
+        locals.parties = state.orderParties.get(input.slot);
+        locals.flags = state.orderFlags.get(input.slot);
+
+        // Populate OrderResponse with BridgeOrder data
+        output.order.orderId = state.orderIds.get(input.slot);
+        output.order.originAccount = locals.parties.qubicSender;
+        output.order.destinationAccount = id(locals.parties.ethAddressLow, locals.parties.ethAddressMid, locals.parties.ethAddressHigh, 0);
+        output.order.amount = state.orderAmounts.get(input.slot);
+        output.order.sourceChain = state.sourceChain;
+        output.order.status = locals.flags & ETHBRIDGE_ORDER_STATUS_MASK;
+        output.order.fromQubicToEthereum = (locals.flags & ETHBRIDGE_ORDER_TO_ETHEREUM) != 0;
+        output.order.createdTick = state.orderCreatedTicks.get(input.slot);
+        output.order.finishedTick = state.orderFinishedTicks.get(input.slot);
+        output.order.priorityFee = state.orderPriorityFees.get(input.slot);
+    _
+
+public:
+    // Retrieve an order (read-only, writes no log records)
+    struct getOrder_locals {
+        uint64 slot;
+        readOrderSlot_input readInput;
+        readOrderSlot_output readOutput;
+    };
+
+    PUBLIC_FUNCTION_WITH_LOCALS(getOrder)
+        if (state.orderIndex.get(input.orderId, locals.slot) && (state.orderFlags.get(locals.slot) & ETHBRIDGE_ORDER_STATUS_MASK) != ETHBRIDGE_ORDER_EMPTY) {
+            locals.readInput.slot = locals.slot;
+            CALL(readOrderSlot, locals.readInput, locals.readOutput);
+            output.status = 0; // Success
+            output.order = locals.readOutput.order;
+            return;
+        }
+
+        // If order not found
+        output.status = 1; // Error
+    _
+
+    // Retrieve the orders with IDs from startOrderId on, in ID order.
+    // At most ETHBRIDGE_ORDER_SCAN_WINDOW IDs are examined per call;
+    // continue from nextOrderId.
+    struct getOrders_locals {
+        uint64 slot;
+        uint64 orderId;
+        uint64 endOrderId;
+        uint64 maxCount;
+        readOrderSlot_input readInput;
+        readOrderSlot_output readOutput;
+    };
+
+    PUBLIC_FUNCTION_WITH_LOCALS(getOrders)
+        output.count = 0;
+
+        locals.maxCount = input.maxCount;
+        if (locals.maxCount == 0 || locals.maxCount > output.orders.capacity()) {
+            locals.maxCount = output.orders.capacity();
+        }
+        locals.endOrderId = input.startOrderId + ETHBRIDGE_ORDER_SCAN_WINDOW;
+        if (locals.endOrderId > state.nextOrderId || locals.endOrderId < input.startOrderId) {
+            locals.endOrderId = state.nextOrderId;
+        }
+
+        for (locals.orderId = input.startOrderId; locals.orderId < locals.endOrderId && output.count < locals.maxCount; ++locals.orderId) {
+            if (state.orderIndex.get(locals.orderId, locals.slot) && (state.orderFlags.get(locals.slot) & ETHBRIDGE_ORDER_STATUS_MASK) != ETHBRIDGE_ORDER_EMPTY) {
+                locals.readInput.slot = locals.slot;
+                CALL(readOrderSlot, locals.readInput, locals.readOutput);
+                output.orders.set(output.count++, locals.readOutput.order);
+            }
+        }
+        output.nextOrderId = (locals.orderId > input.startOrderId) ? locals.orderId : input.startOrderId;
+    _
+
+    // Retrieve specific orders by ID; entries that are not stored are
+    // reported through found[i] instead of failing the whole call
+    struct getOrdersByIds_locals {
+        uint64 i;
+        uint64 slot;
+        readOrderSlot_input readInput;
+        readOrderSlot_output readOutput;
+    };
+
+    PUBLIC_FUNCTION_WITH_LOCALS(getOrdersByIds)
+        output.foundCount = 0;
+
+        if (input.orderCount > input.orderIds.capacity()) {
+            output.status = 1; // Error
+            return;
+        }
+
+        for (locals.i = 0; locals.i < input.orderCount; ++locals.i) {
+            if (state.orderIndex.get(input.orderIds.get(locals.i), locals.slot) && (state.orderFlags.get(locals.slot) & ETHBRIDGE_ORDER_STATUS_MASK) != ETHBRIDGE_ORDER_EMPTY) {
+                locals.readInput.slot = locals.slot;
+                CALL(readOrderSlot, locals.readInput, locals.readOutput);
+                output.orders.set(locals.i, locals.readOutput.order);
+                output.found.set(locals.i, true);
+                output.foundCount++;
+            }
+            else {
+                output.found.set(locals.i, false);
+            }
+        }
+        output.status = 0; // Success
+    _
+
+    // Retrieve the oldest pending orders of one direction. With
+    // continueAfter set, the walk resumes after afterOrderId if that order
+    // is still pending, otherwise it starts at the oldest order.
+    struct getPendingOrders_locals {
+        uint64 queue;
+        uint64 slot;
+        sint64 cursor;
+        uint64 maxCount;
+        readOrderSlot_input readInput;
+        readOrderSlot_output readOutput;
+    };
+
+    PUBLIC_FUNCTION_WITH_LOCALS(getPendingOrders)
+        output.count = 0;
+        locals.queue = input.fromQubicToEthereum ? 1 : 0;
+        output.totalPending = state.pendingCount.get(locals.queue);
+
+        locals.maxCount = input.maxCount;
+        if (locals.maxCount == 0 || locals.maxCount > output.orders.capacity()) {
+            locals.maxCount = output.orders.capacity();
+        }
+
+        locals.cursor = state.pendingHead.get(locals.queue);
+        if (input.continueAfter && state.orderIndex.get(input.afterOrderId, locals.slot)
+            && (state.orderFlags.get(locals.slot) & ETHBRIDGE_ORDER_STATUS_MASK) == ETHBRIDGE_ORDER_CREATED
+            && ((state.orderFlags.get(locals.slot) & ETHBRIDGE_ORDER_TO_ETHEREUM) != 0) == input.fromQubicToEthereum) {
+            locals.cursor = state.pendingNext.get(locals.slot);
+        }
+
+        while (locals.cursor != NULL_INDEX && output.count < locals.maxCount) {
+            locals.readInput.slot = locals.cursor;
+            CALL(readOrderSlot, locals.readInput, locals.readOutput);
+            output.orders.set(output.count++, locals.readOutput.order);
+            locals.cursor = state.pendingNext.get(locals.cursor);
+        }
+    _
+
+    // Retrieve the pending orders of both directions with the highest
+    // priority fee, oldest first among equal fees
+    struct getNextOrdersByPriority_locals {
+        sint64 elementIndex;
+        uint64 maxCount;
+        readOrderSlot_input readInput;
+        readOrderSlot_output readOutput;
+    };
+
+    PUBLIC_FUNCTION_WITH_LOCALS(getNextOrdersByPriority)
+        output.count = 0;
+        output.totalPending = state.priorityOrders.population(SELF);
+
+        locals.maxCount = input.maxCount;
+        if (locals.maxCount == 0 || locals.maxCount > output.orders.capacity()) {
+            locals.maxCount = output.orders.capacity();
+        }
+
+        locals.elementIndex = state.priorityOrders.headIndex(SELF);
+        while (locals.elementIndex != NULL_INDEX && output.count < locals.maxCount) {
+            locals.readInput.slot = state.priorityOrders.element(locals.elementIndex);
+            CALL(readOrderSlot, locals.readInput, locals.readOutput);
+            output.orders.set(output.count++, locals.readOutput.order);
+            locals.elementIndex = state.priorityOrders.nextElementIndex(locals.elementIndex);
+        }
+    _
+
+    // Retrieve the oldest pending orders of one direction that belong to the
+    // shards of one manager. At most ETHBRIDGE_ORDER_SCAN_WINDOW pending
+    // orders are examined per call; continue after the returned afterOrderId.
+    struct getPendingOrdersForManager_locals {
+        uint64 queue;
+        uint64 slot;
+        sint64 cursor;
+        uint64 maxCount;
+        uint64 examined;
+        uint64 shard;
+        id owner;
+        readOrderSlot_input readInput;
+        readOrderSlot_output readOutput;
+    };
+
+    PUBLIC_FUNCTION_WITH_LOCALS(getPendingOrdersForManager)
+        output.count = 0;
+        output.afterOrderId = 0;
+        locals.queue = input.fromQubicToEthereum ? 1 : 0;
+
+        locals.maxCount = input.maxCount;
+        if (locals.maxCount == 0 || locals.maxCount > output.orders.capacity()) {
+            locals.maxCount = output.orders.capacity();
+        }
+
+        locals.cursor = state.pendingHead.get(locals.queue);
+        if (input.continueAfter && state.orderIndex.get(input.afterOrderId, locals.slot)
+            && (state.orderFlags.get(locals.slot) & ETHBRIDGE_ORDER_STATUS_MASK) == ETHBRIDGE_ORDER_CREATED
+            && ((state.orderFlags.get(locals.slot) & ETHBRIDGE_ORDER_TO_ETHEREUM) != 0) == input.fromQubicToEthereum) {
+            locals.cursor = state.pendingNext.get(locals.slot);
+        }
+
+        for (locals.examined = 0; locals.cursor != NULL_INDEX && output.count < locals.maxCount && locals.examined < ETHBRIDGE_ORDER_SCAN_WINDOW; ++locals.examined) {
+            output.afterOrderId = state.orderIds.get(locals.cursor);
+            CALL(orderShard, output.afterOrderId, locals.shard);
+            locals.owner = state.shardOwners.get(locals.shard);
+            if (locals.owner == input.manager || (input.includeUnassigned && locals.owner == NULL_ID)) {
+                locals.readInput.slot = locals.cursor;
+                CALL(readOrderSlot, locals.readInput, locals.readOutput);
+                output.orders.set(output.count++, locals.readOutput.order);
+            }
+            locals.cursor = state.pendingNext.get(locals.cursor);
+        }
+        output.reachedEnd = (locals.cursor == NULL_INDEX);
+    _
+
+    // Retrieve the orders created by one sender, newest first. Pass the
+    // returned nextOrderId as beforeOrderId to page towards older orders.
+    struct getOrdersBySender_locals {
+        sint64 elementIndex;
+        uint64 maxCount;
+        readOrderSlot_input readInput;
+        readOrderSlot_output readOutput;
+    };
+
+    PUBLIC_FUNCTION_WITH_LOCALS(getOrdersBySender)
+        output.count = 0;
+        output.nextOrderId = 0;
+        output.totalOrders = state.senderOrders.population(input.sender);
+
+        locals.maxCount = input.maxCount;
+        if (locals.maxCount == 0 || locals.maxCount > output.orders.capacity()) {
+            locals.maxCount = output.orders.capacity();
+        }
+
+        if (input.beforeOrderId == 0) {
+            locals.elementIndex = state.senderOrders.headIndex(input.sender);
+        }
+        else {
+            locals.elementIndex = state.senderOrders.headIndex(input.sender, input.beforeOrderId - 1);
+        }
+
+        while (locals.elementIndex != NULL_INDEX && output.count < locals.maxCount) {
+            locals.readInput.slot = state.senderOrders.element(locals.elementIndex);
+            CALL(readOrderSlot, locals.readInput, locals.readOutput);
+            output.orders.set(output.count++, locals.readOutput.order);
+            locals.elementIndex = state.senderOrders.nextElementIndex(locals.elementIndex);
+        }
+
+        // Only hand out a cursor when older orders remain
+        if (locals.elementIndex != NULL_INDEX) {
+            output.nextOrderId = locals.readOutput.order.orderId;
+        }
     _
 
     // Admin Functions
     struct setAdmin_locals {
         EthBridgeLogger log;
+        logError_output errorLogged;
         AddressChangeLogger adminLog;
     };
 
@@ -321,35 +1368,40 @@ public:
                 0, // No amount involved
                 0
             };
-            LOG_INFO(locals.log);
+            CALL(logError, locals.log, locals.errorLogged);
             output.status = 1; // Error
             return;
         }
 
         state.admin = input.address;
         //Logging the admin address has changed
-        locals.adminLog = AddressChangeLogger{
-            CONTRACT_INDEX,
-            1, // Event code "Admin Changed"
-            input.address,
-            0
-        };
-
-        LOG_INFO(locals.adminLog);
-
-        locals.log = EthBridgeLogger{
-            CONTRACT_INDEX,
-            0, // No error
-            0, // No order ID involved
-            0, // No amount involved
-            0
-        };
-        LOG_INFO(locals.log);
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_STATE) {
+            locals.adminLog = AddressChangeLogger{
+                CONTRACT_INDEX,
+                1, // Event code "Admin Changed"
+                input.address,
+                0
+            };
+
+            LOG_INFO(locals.adminLog);
+        }
+
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_VERBOSE) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                0, // No error
+                0, // No order ID involved
+                0, // No amount involved
+                0
+            };
+            LOG_INFO(locals.log);
+        }
         output.status = 0; // Success
     _
 
     struct addManager_locals {
         EthBridgeLogger log;
+        logError_output errorLogged;
         AddressChangeLogger managerLog;
     };
 
@@ -363,46 +1415,786 @@ public:
                 0, // No amount involved
                 0
             };
-            LOG_INFO(locals.log)
-                output.status = 1; // Error
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 1; // Error
+            return;
+        }
+
+        if (input.address == NULL_ID || state.managers.contains(input.address)) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::managerAlreadyExists,
+                0, // No order ID involved
+                0, // No amount involved
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 2; // Error
+            return;
+        }
+
+        if (state.managers.add(input.address) == NULL_INDEX) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::managerLimitReached,
+                0, // No order ID involved
+                0, // No amount involved
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 3; // Error
+            return;
+        }
+
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_STATE) {
+            locals.managerLog = AddressChangeLogger{
+                CONTRACT_INDEX,
+                2, // Manager added
+                input.address,
+                0
+            };
+            LOG_INFO(locals.managerLog);
+        }
+        output.status = 0; // Success
+    _
+
+    struct removeManager_locals {
+        EthBridgeLogger log;
+        logError_output errorLogged;
+        AddressChangeLogger managerLog;
+        uint64 i;
+    };
+
+    PUBLIC_PROCEDURE_WITH_LOCALS(removeManager)
+
+        if (qpi.invocator() != state.admin) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::onlyManagersCanCompleteOrders,
+                0, // No order ID involved
+                0, // No amount involved
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+
+            output.status = 1; // Error
             return;
         }
 
-        for (uint64 i = 0; i < state.managers.capacity(); ++i) {
-            if (state.managers.get(i) == NULL_ID) { // Slot vacío
-                state.managers.set(i, input.address);
+        if (state.managers.remove(input.address) != NULL_INDEX) {
+            state.managers.cleanupIfNeeded();
+
+            // Hand the removed manager's shards back to all managers
+            for (locals.i = 0; locals.i < state.shardOwners.capacity(); ++locals.i) {
+                if (state.shardOwners.get(locals.i) == input.address) {
+                    state.shardOwners.set(locals.i, NULL_ID);
+                }
+            }
 
+            if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_STATE) {
                 locals.managerLog = AddressChangeLogger{
                     CONTRACT_INDEX,
-                    2, // Manager added
+                    3, // Manager removed
                     input.address,
                     0
                 };
                 LOG_INFO(locals.managerLog);
-                output.status = 0; // Success
-                return;
             }
+            output.status = 0; // Success
+            return;
+        }
+
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_VERBOSE) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                0, // No error
+                0, // No order ID involved
+                0, // No amount involved
+                0
+            };
+            LOG_INFO(locals.log);
+        }
+        output.status = 0; // Success
+    _
+
+    struct setRetentionEpochs_locals {
+        EthBridgeLogger log;
+        logError_output errorLogged;
+        ConfigLogger configLog;
+    };
+
+    PUBLIC_PROCEDURE_WITH_LOCALS(setRetentionEpochs)
+
+        if (qpi.invocator() != state.admin) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::onlyManagersCanCompleteOrders,
+                0, // No order ID involved
+                0, // No amount involved
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 1; // Error
+            return;
         }
 
-        locals.log = EthBridgeLogger{
-            CONTRACT_INDEX,
-            0, // No error
-            0, // No order ID involved
-            0, // No amount involved
-            0
-        };
-        LOG_INFO(locals.log);
+        state.retentionEpochs = input.epochs;
+
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_STATE) {
+            locals.configLog = ConfigLogger{
+                CONTRACT_INDEX,
+                EthBridgeSetting::retentionEpochsChanged,
+                NULL_ID,
+                input.epochs,
+                0
+            };
+            LOG_INFO(locals.configLog);
+        }
         output.status = 0; // Success
     _
 
-    struct removeManager_locals {
+    struct setOrderTimeout_locals {
         EthBridgeLogger log;
-        AddressChangeLogger managerLog;
+        logError_output errorLogged;
+        ConfigLogger configLog;
+    };
+
+    PUBLIC_PROCEDURE_WITH_LOCALS(setOrderTimeout)
+
+        if (qpi.invocator() != state.admin) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::onlyManagersCanCompleteOrders,
+                0, // No order ID involved
+                0, // No amount involved
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 1; // Error
+            return;
+        }
+
+        state.orderTimeoutTicks = input.timeoutTicks;
+
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_STATE) {
+            locals.configLog = ConfigLogger{
+                CONTRACT_INDEX,
+                EthBridgeSetting::orderTimeoutChanged,
+                NULL_ID,
+                input.timeoutTicks,
+                0
+            };
+            LOG_INFO(locals.configLog);
+        }
+        output.status = 0; // Success
+    _
+
+    struct setShardOwner_locals {
+        EthBridgeLogger log;
+        logError_output errorLogged;
+        ConfigLogger configLog;
     };
 
-    PUBLIC_PROCEDURE_WITH_LOCALS(removeManager)
+    PUBLIC_PROCEDURE_WITH_LOCALS(setShardOwner)
+
+        if (qpi.invocator() != state.admin) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::onlyManagersCanCompleteOrders,
+                0, // No order ID involved
+                0, // No amount involved
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 1; // Error
+            return;
+        }
+
+        // Only current managers can own a shard
+        if (input.shard >= ETHBRIDGE_SHARD_COUNT || (input.manager != NULL_ID && !state.managers.contains(input.manager))) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::wrongShard,
+                0, // No order ID involved
+                input.shard,
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 2; // Error
+            return;
+        }
+
+        state.shardOwners.set(input.shard, input.manager);
+
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_STATE) {
+            locals.configLog = ConfigLogger{
+                CONTRACT_INDEX,
+                EthBridgeSetting::shardOwnerChanged,
+                input.manager,
+                input.shard,
+                0
+            };
+            LOG_INFO(locals.configLog);
+        }
+        output.status = 0; // Success
+    _
+
+    PUBLIC_FUNCTION(getShardOwners)
+        output.owners = state.shardOwners;
+    _
+
+    struct setPayoutMode_locals {
+        EthBridgeLogger log;
+        logError_output errorLogged;
+        ConfigLogger configLog;
+    };
+
+    // Switch between inline and deferred Ethereum -> Qubic payouts. Payouts
+    // already queued keep draining after switching back to inline mode.
+    PUBLIC_PROCEDURE_WITH_LOCALS(setPayoutMode)
+
+        if (qpi.invocator() != state.admin) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::onlyManagersCanCompleteOrders,
+                0, // No order ID involved
+                0, // No amount involved
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 1; // Error
+            return;
+        }
+
+        // A zero budget would never drain the queue
+        if (input.transfersPerTick == 0) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::invalidAmount,
+                0, // No order ID involved
+                0,
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 2; // Error
+            return;
+        }
+
+        state.deferPayouts = input.deferred;
+        state.payoutsPerTick = input.transfersPerTick;
+
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_STATE) {
+            locals.configLog = ConfigLogger{
+                CONTRACT_INDEX,
+                input.deferred ? EthBridgeSetting::payoutsDeferred : EthBridgeSetting::payoutsInline,
+                NULL_ID,
+                input.transfersPerTick,
+                0
+            };
+            LOG_INFO(locals.configLog);
+        }
+        output.status = 0; // Success
+    _
+
+    PUBLIC_FUNCTION(getPayoutQueue)
+        output.deferred = state.deferPayouts;
+        output.transfersPerTick = state.payoutsPerTick;
+        output.queuedRecipients = state.payoutQueueCount;
+        output.queuedAmount = state.queuedPayoutTotal;
+    _
+
+    // Retrieve a finalized batch commitment. The last
+    // ETHBRIDGE_BATCH_HISTORY batches are kept.
+    PUBLIC_FUNCTION(getBatch)
+        output.batchCount = state.batchCount;
+        if (input.batchId >= state.batchCount || input.batchId + ETHBRIDGE_BATCH_HISTORY < state.batchCount) {
+            output.status = 1; // Error
+            return;
+        }
+        output.batch = state.batches.get(input.batchId & (ETHBRIDGE_BATCH_HISTORY - 1));
+        output.status = 0; // Success
+    _
+
+    PUBLIC_FUNCTION(getRetiredSummary)
+        output.summary = state.retired;
+        output.retentionEpochs = state.retentionEpochs;
+    _
+
+    PUBLIC_FUNCTION(getStats)
+        output.orderCounts = state.orderCounts;
+        output.pendingAmounts = state.pendingAmounts;
+        output.errorCounts = state.errorCounts;
+        output.transactionFee = state.transactionFee;
+        output.lockedTokens = state.lockedTokens;
+        output.totalReceivedTokens = state.totalReceivedTokens;
+        output.orderDeposits = state.orderDeposits;
+        output.freeSlots = state.freeSlotCount;
+        output.occupiedSlots = ETHBRIDGE_MAX_ORDERS - state.freeSlotCount;
+        output.expiredOrders = state.expiredOrders;
+        output.orderTimeoutTicks = state.orderTimeoutTicks;
+    _
+
+    PUBLIC_FUNCTION(getLatencyHistogram)
+        output.buckets = state.latencyHistogram;
+        output.totalLatencyTicks = state.totalLatencyTicks;
+        output.completedCount = state.completedCount;
+    _
+
+    PUBLIC_FUNCTION(getTotalReceivedTokens)
+        output.totalTokens = state.totalReceivedTokens;
+    _
+
+    PUBLIC_FUNCTION(getTotalLockedTokens)
+        output.totalLockedTokens = state.lockedTokens;
+    _
+
+private:
+    // Batch commitments: the open batch keeps an incremental Merkle tree
+    // (only the left siblings of the next leaf), so appending costs at most
+    // ETHBRIDGE_BATCH_TREE_DEPTH hashes and no leaves are stored
+    struct appendBatchLeaf_input {
+        BridgeOrder order;
+    };
+
+    struct appendBatchLeaf_output {
+    };
+
+    struct appendBatchLeaf_locals {
+        BatchLeaf leaf;
+        struct {
+            id left;
+            id right;
+        } node;
+        id hash;
+        uint64 size;
+        uint64 height;
+    };
+
+    PRIVATE_PROCEDURE_WITH_LOCALS(appendBatchLeaf)
+        locals.leaf.orderId = input.order.orderId;
+        locals.leaf.amount = input.order.amount;
+        locals.leaf.ethAddressLow = input.order.ethAddressLow;
+        locals.leaf.ethAddressMid = input.order.ethAddressMid;
+        locals.leaf.ethAddressHigh = input.order.ethAddressHigh;
+        locals.leaf.reserved = 0;
+        locals.hash = qpi.K12(locals.leaf);
+
+        if (state.openBatch.orderCount == 0) {
+            state.openBatch.tick = qpi.tick();
+            state.openBatch.firstOrderId = input.order.orderId;
+            state.openBatch.lastOrderId = input.order.orderId;
+        }
+        else if (input.order.orderId < state.openBatch.firstOrderId) {
+            state.openBatch.firstOrderId = input.order.orderId;
+        }
+        else if (input.order.orderId > state.openBatch.lastOrderId) {
+            state.openBatch.lastOrderId = input.order.orderId;
+        }
+        state.openBatch.totalAmount += input.order.amount;
+
+        // Merge the new leaf with every complete left subtree it closes
+        locals.size = ++state.openBatch.orderCount;
+        for (locals.height = 0; locals.height < ETHBRIDGE_BATCH_TREE_DEPTH; ++locals.height) {
+            if (locals.size & 1) {
+                state.batchBranch.set(locals.height, locals.hash);
+                break;
+            }
+            locals.node.left = state.batchBranch.get(locals.height);
+            locals.node.right = locals.hash;
+            locals.hash = qpi.K12(locals.node);
+            locals.size >>= 1;
+        }
+    _
+
+    struct closeBatch_input {
+    };
+
+    struct closeBatch_output {
+    };
+
+    struct closeBatch_locals {
+        BatchLogger log;
+        struct {
+            id left;
+            id right;
+        } node;
+        id hash;
+        uint64 size;
+        uint64 height;
+    };
+
+    // Computes the root of the open batch, stores it in the history ring
+    // and starts a new batch. Does nothing if the open batch is empty.
+    PRIVATE_PROCEDURE_WITH_LOCALS(closeBatch)
+        if (state.openBatch.orderCount == 0) {
+            return;
+        }
+
+        locals.hash = state.batchZeroHashes.get(0);
+        locals.size = state.openBatch.orderCount;
+        for (locals.height = 0; locals.height < ETHBRIDGE_BATCH_TREE_DEPTH; ++locals.height) {
+            if (locals.size & 1) {
+                locals.node.left = state.batchBranch.get(locals.height);
+                locals.node.right = locals.hash;
+            }
+            else {
+                locals.node.left = locals.hash;
+                locals.node.right = state.batchZeroHashes.get(locals.height);
+            }
+            locals.hash = qpi.K12(locals.node);
+            locals.size >>= 1;
+        }
+
+        state.openBatch.batchId = state.batchCount;
+        state.openBatch.root = locals.hash;
+        state.batches.set(state.batchCount & (ETHBRIDGE_BATCH_HISTORY - 1), state.openBatch);
+        ++state.batchCount;
+
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_STATE) {
+            locals.log = BatchLogger{
+                CONTRACT_INDEX,
+                EthBridgeEvent::batchCommitted,
+                state.openBatch.batchId,
+                state.openBatch.firstOrderId,
+                state.openBatch.lastOrderId,
+                state.openBatch.totalAmount,
+                state.openBatch.root,
+                state.openBatch.tick,
+                state.openBatch.orderCount,
+                0
+            };
+            LOG_INFO(locals.log);
+        }
+
+        state.openBatch.orderCount = 0;
+        state.openBatch.totalAmount = 0;
+    _
+
+    // Validates and completes a single order without checking the invocator.
+    // Errors are logged per order; the caller logs the resulting balances.
+    struct processCompletion_input {
+        uint64 orderId;
+    };
+
+    struct processCompletion_output {
+        uint8 status;                        // Same codes as completeOrder_output
+        uint64 amount;                       // Amount settled when status is 0
+    };
+
+    struct processCompletion_locals {
+        EthBridgeLogger log;
+        logError_output errorLogged;
+        bit orderFound;
+        uint64 slot;
+        loadOrder_input loadInput;
+        loadOrder_output loadOutput;
+        BridgeOrder order;
+        OrderEventLogger event;
+        uint64 statsIndex;
+        uint64 latency;
+        uint64 bucket;
+        uint64 payout;
+        bit recipientQueued;
+        bit payoutQueued;
+        unlinkPending_input pendingInput;
+        unlinkPending_output pendingOutput;
+        appendBatchLeaf_input batchInput;
+        appendBatchLeaf_output batchOutput;
+        closeBatch_input closeInput;
+        closeBatch_output closeOutput;
+    };
+
+    PRIVATE_PROCEDURE_WITH_LOCALS(processCompletion)
+        output.amount = 0;
+
+        locals.orderFound = state.orderIndex.get(input.orderId, locals.slot);
+        if (locals.orderFound) {
+            locals.loadInput.slot = locals.slot;
+            CALL(loadOrder, locals.loadInput, locals.loadOutput);
+            locals.order = locals.loadOutput.order;
+        }
+
+        // Order nor found
+        if (!locals.orderFound) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::orderNotFound,
+                input.orderId,
+                0,
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 2; // Error
+            return;
+        }
+
+        // Check order status
+        // All orders status are 0 when created
+        if ((locals.order.flags & ETHBRIDGE_ORDER_STATUS_MASK) != ETHBRIDGE_ORDER_CREATED) { //Check it is not completed or refunded already
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::invalidOrderState,
+                input.orderId,
+                0,
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 3; // Error
+            return;
+        }
+
+        // Handle order based on transfer direction
+        if ((locals.order.flags & ETHBRIDGE_ORDER_TO_ETHEREUM) && (locals.order.flags & ETHBRIDGE_ORDER_DEPOSIT_BOUND)) {
+            // The tokens were paid in with the order, lock them directly
+            state.orderDeposits -= locals.order.amount;
+            state.lockedTokens += locals.order.amount;
+        }
+        else if (locals.order.flags & ETHBRIDGE_ORDER_TO_ETHEREUM) {
+            // Ensure sufficient tokens were transferred to the contract
+            if (state.totalReceivedTokens - state.lockedTokens < locals.order.amount) {
+                locals.log = EthBridgeLogger{
+                    CONTRACT_INDEX,
+                    EthBridgeError::insufficientLockedTokens,
+                    input.orderId,
+                    locals.order.amount,
+                    0
+                };
+                CALL(logError, locals.log, locals.errorLogged);
+                output.status = 4; // Error
+                return;
+            }
+
+            state.lockedTokens += locals.order.amount; //increase the amount of locked tokens
+            state.totalReceivedTokens -= locals.order.amount; //decrease the amount of no-locked (received) tokens
+        }
+        else {
+            // Ensure sufficient tokens are locked for the order
+            if (state.lockedTokens < locals.order.amount) {
+                locals.log = EthBridgeLogger{
+                    CONTRACT_INDEX,
+                    EthBridgeError::insufficientLockedTokens,
+                    input.orderId,
+                    locals.order.amount,
+                    0
+                };
+                CALL(logError, locals.log, locals.errorLogged);
+                output.status = 5; // Error
+                return;
+            }
+
+            // In deferred mode the payout is added to the recipient's queued
+            // total and paid in END_TICK. A full queue falls back to paying inline.
+            locals.payoutQueued = false;
+            if (state.deferPayouts) {
+                locals.payout = 0;
+                locals.recipientQueued = state.queuedPayouts.get(locals.order.qubicSender, locals.payout);
+                if (locals.recipientQueued || state.payoutQueueCount < state.payoutQueue.capacity()) {
+                    locals.payoutQueued = state.queuedPayouts.set(locals.order.qubicSender, locals.payout + locals.order.amount) != NULL_INDEX;
+                }
+                if (locals.payoutQueued) {
+                    if (!locals.recipientQueued) {
+                        state.payoutQueue.set((state.payoutQueueHead + state.payoutQueueCount) & (ETHBRIDGE_MAX_ORDERS - 1), locals.order.qubicSender);
+                        ++state.payoutQueueCount;
+                    }
+                    state.queuedPayoutTotal += locals.order.amount;
+                }
+            }
+
+            // Transfer tokens back to the user
+            if (!locals.payoutQueued && qpi.transfer(locals.order.qubicSender, locals.order.amount) < 0) {
+                locals.log = EthBridgeLogger{
+                    CONTRACT_INDEX,
+                    EthBridgeError::transferFailed,
+                    input.orderId,
+                    locals.order.amount,
+                    0
+                };
+                CALL(logError, locals.log, locals.errorLogged);
+                output.status = 6; // Error
+                return;
+            }
+
+            state.lockedTokens -= locals.order.amount;
+        }
+
+        // Mark the order as completed
+        locals.order.flags = (uint8)((locals.order.flags & ~ETHBRIDGE_ORDER_STATUS_MASK) | ETHBRIDGE_ORDER_COMPLETED);
+        locals.order.finishedEpoch = qpi.epoch();
+        locals.order.finishedTick = qpi.tick();
+        state.orderFlags.set(locals.slot, locals.order.flags);
+        state.orderFinishedEpochs.set(locals.slot, locals.order.finishedEpoch);
+        state.orderFinishedTicks.set(locals.slot, locals.order.finishedTick);
+        state.finishedPerBlock.set(locals.slot >> ETHBRIDGE_SWEEP_BLOCK_BITS, state.finishedPerBlock.get(locals.slot >> ETHBRIDGE_SWEEP_BLOCK_BITS) + 1);
+
+        locals.pendingInput.slot = locals.slot;
+        locals.pendingInput.fromQubicToEthereum = (locals.order.flags & ETHBRIDGE_ORDER_TO_ETHEREUM) != 0;
+        CALL(unlinkPending, locals.pendingInput, locals.pendingOutput);
+
+        locals.statsIndex = (ETHBRIDGE_ORDER_CREATED << 1) | (locals.pendingInput.fromQubicToEthereum ? 1 : 0);
+        state.orderCounts.set(locals.statsIndex, state.orderCounts.get(locals.statsIndex) - 1);
+        locals.statsIndex = (ETHBRIDGE_ORDER_COMPLETED << 1) | (locals.pendingInput.fromQubicToEthereum ? 1 : 0);
+        state.orderCounts.set(locals.statsIndex, state.orderCounts.get(locals.statsIndex) + 1);
+        locals.statsIndex = locals.pendingInput.fromQubicToEthereum ? 1 : 0;
+        state.pendingAmounts.set(locals.statsIndex, state.pendingAmounts.get(locals.statsIndex) - locals.order.amount);
+
+        // Record the create -> complete latency in its log2 bucket
+        locals.latency = locals.order.finishedTick - locals.order.createdTick;
+        state.totalLatencyTicks.set(locals.statsIndex, state.totalLatencyTicks.get(locals.statsIndex) + locals.latency);
+        state.completedCount.set(locals.statsIndex, state.completedCount.get(locals.statsIndex) + 1);
+        for (locals.bucket = 0; locals.latency > 0 && locals.bucket < ETHBRIDGE_LATENCY_BUCKETS - 1; ++locals.bucket) {
+            locals.latency >>= 1;
+        }
+        locals.bucket += locals.statsIndex * ETHBRIDGE_LATENCY_BUCKETS;
+        state.latencyHistogram.set(locals.bucket, state.latencyHistogram.get(locals.bucket) + 1);
+
+        // Commit the order to the batch minted on Ethereum. A batch holds at
+        // most 2^ETHBRIDGE_BATCH_TREE_DEPTH - 1 orders (the root is computed
+        // from the left siblings of the next free leaf); a full batch is
+        // finalized early and the tick continues in a new one.
+        if (locals.pendingInput.fromQubicToEthereum) {
+            if (state.openBatch.orderCount == (1ULL << ETHBRIDGE_BATCH_TREE_DEPTH) - 1) {
+                CALL(closeBatch, locals.closeInput, locals.closeOutput);
+            }
+            locals.batchInput.order = locals.order;
+            CALL(appendBatchLeaf, locals.batchInput, locals.batchOutput);
+        }
+
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_STATE) {
+            locals.event = OrderEventLogger{
+                CONTRACT_INDEX,
+                EthBridgeEvent::orderCompleted,
+                locals.order.orderId,
+                locals.order.qubicSender,
+                id(locals.order.ethAddressLow, locals.order.ethAddressMid, locals.order.ethAddressHigh, 0),
+                locals.order.amount,
+                qpi.tick(),
+                locals.pendingInput.fromQubicToEthereum,
+                0
+            };
+            LOG_INFO(locals.event);
+        }
+
+        output.status = 0; // Success
+        output.amount = locals.order.amount;
+    _
+
+    // Rejects orders whose shard belongs to another manager. Called before the
+    // order is loaded so losing relayers fail as cheaply as possible.
+    struct checkShard_input {
+        uint64 orderId;
+        id manager;
+    };
+
+    struct checkShard_output {
+        bit allowed;
+    };
+
+    struct checkShard_locals {
+        EthBridgeLogger log;
+        logError_output errorLogged;
+        uint64 shard;
+        id owner;
+    };
+
+    PRIVATE_PROCEDURE_WITH_LOCALS(checkShard)
+        CALL(orderShard, input.orderId, locals.shard);
+        locals.owner = state.shardOwners.get(locals.shard);
+        output.allowed = (locals.owner == NULL_ID || locals.owner == input.manager);
+        if (!output.allowed) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::wrongShard,
+                input.orderId,
+                locals.shard,
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+        }
+    _
+
+public:
+    struct completeOrder_locals {
+        EthBridgeLogger log;
+        logError_output errorLogged;
+        id invocatorAddress;
+        bit isManagerOperating;
+        processCompletion_input completionInput;
+        processCompletion_output completionOutput;
+        checkShard_input shardInput;
+        checkShard_output shardOutput;
+        TokensLogger logTokens;
+    };
+
+    // Complete an order and release tokens
+    PUBLIC_PROCEDURE_WITH_LOCALS(completeOrder)
+        locals.invocatorAddress = qpi.invocator();
+        locals.isManagerOperating = false;
+        CALL(isManager, locals.invocatorAddress, locals.isManagerOperating);
+
+        //Check if the order is handled by a manager
+        if (!locals.isManagerOperating) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::onlyManagersCanCompleteOrders,
+                input.orderId,
+                0, // No amount involved
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 1; // Error
+            return;
+        }
+
+        locals.shardInput.orderId = input.orderId;
+        locals.shardInput.manager = locals.invocatorAddress;
+        CALL(checkShard, locals.shardInput, locals.shardOutput);
+        if (!locals.shardOutput.allowed) {
+            output.status = 7; // Error
+            return;
+        }
+
+        locals.completionInput.orderId = input.orderId;
+        CALL(processCompletion, locals.completionInput, locals.completionOutput);
+        output.status = locals.completionOutput.status;
+        if (output.status != 0) {
+            return;
+        }
+
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_VERBOSE) {
+            locals.logTokens = TokensLogger{
+                CONTRACT_INDEX,
+                state.lockedTokens,
+                state.totalReceivedTokens,
+                0
+            };
+            LOG_INFO(locals.logTokens);
+        }
+
+    _
+
+    struct completeOrders_locals {
+        EthBridgeLogger log;
+        logError_output errorLogged;
+        id invocatorAddress;
+        bit isManagerOperating;
+        processCompletion_input completionInput;
+        processCompletion_output completionOutput;
+        checkShard_input shardInput;
+        checkShard_output shardOutput;
+        TokensLogger logTokens;
+        uint64 i;
+    };
+
+    // Complete a batch of orders with a single manager check and balance log
+    PUBLIC_PROCEDURE_WITH_LOCALS(completeOrders)
+        output.completedCount = 0;
+        output.completedAmount = 0;
+
+        locals.invocatorAddress = qpi.invocator();
+        locals.isManagerOperating = false;
+        CALL(isManager, locals.invocatorAddress, locals.isManagerOperating);
 
-        if (qpi.invocator() != state.admin) {
+        if (!locals.isManagerOperating) {
             locals.log = EthBridgeLogger{
                 CONTRACT_INDEX,
                 EthBridgeError::onlyManagersCanCompleteOrders,
@@ -410,83 +2202,94 @@ public:
                 0, // No amount involved
                 0
             };
-            LOG_INFO(locals.log);
-
+            CALL(logError, locals.log, locals.errorLogged);
             output.status = 1; // Error
             return;
         }
 
-        for (uint64 i = 0; i < state.managers.capacity(); ++i) {
-            if (state.managers.get(i) == input.address) {
-                state.managers.set(i, NULL_ID);
+        if (input.orderCount > input.orderIds.capacity()) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::invalidBatchSize,
+                0, // No order ID involved
+                input.orderCount,
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 2; // Error
+            return;
+        }
+
+        // A failing order only sets its own status, the rest of the batch goes on
+        locals.shardInput.manager = locals.invocatorAddress;
+        for (locals.i = 0; locals.i < input.orderCount; ++locals.i) {
+            locals.shardInput.orderId = input.orderIds.get(locals.i);
+            CALL(checkShard, locals.shardInput, locals.shardOutput);
+            if (!locals.shardOutput.allowed) {
+                output.orderStatus.set(locals.i, 7); // Error
+                continue;
+            }
 
-                locals.managerLog = AddressChangeLogger{
-                    CONTRACT_INDEX,
-                    3, // Manager removed
-                    input.address,
-                    0
-                };
-                LOG_INFO(locals.managerLog);
-                output.status = 0; // Success
-                return;
+            locals.completionInput.orderId = input.orderIds.get(locals.i);
+            CALL(processCompletion, locals.completionInput, locals.completionOutput);
+            output.orderStatus.set(locals.i, locals.completionOutput.status);
+            if (locals.completionOutput.status == 0) {
+                ++output.completedCount;
+                output.completedAmount += locals.completionOutput.amount;
             }
         }
 
-        locals.log = EthBridgeLogger{
-            CONTRACT_INDEX,
-            0, // No error
-            0, // No order ID involved
-            0, // No amount involved
-            0
-        };
-        LOG_INFO(locals.log);
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_STATE && output.completedCount > 0) {
+            locals.logTokens = TokensLogger{
+                CONTRACT_INDEX,
+                state.lockedTokens,
+                state.totalReceivedTokens,
+                0
+            };
+            LOG_INFO(locals.logTokens);
+        }
         output.status = 0; // Success
     _
 
-    struct getTotalReceivedTokens_locals {
-        EthBridgeLogger log;
+private:
+    // Validates and refunds a single order without checking the invocator.
+    // The payout itself is left to the caller so that refunds can be grouped.
+    struct processRefund_input {
+        uint64 orderId;
+        uint64 availableBalance;             // Contract balance not yet promised to other payouts
+        bit expired;                         // Called by the expiry sweep: only bound deposits are paid back
     };
 
-    PUBLIC_FUNCTION_WITH_LOCALS(getTotalReceivedTokens)
-
-        locals.log = EthBridgeLogger{
-            CONTRACT_INDEX,
-            0, // No error
-            0, // No order ID involved
-            state.totalReceivedTokens, // Amount of total tokens
-            0
-        };
-        LOG_INFO(locals.log);
-        output.totalTokens = state.totalReceivedTokens;
-    _
-
-    PUBLIC_FUNCTION(getTotalLockedTokens)
-        output.totalLockedTokens = state.lockedTokens;
-    _
+    struct processRefund_output {
+        uint8 status;                        // Same codes as refundOrder_output
+        id recipient;                        // Account to pay when status is 0
+        uint64 amount;                       // Amount to pay when status is 0 (0 for an order expired without payout)
+    };
 
-    struct completeOrder_locals {
+    struct processRefund_locals {
         EthBridgeLogger log;
-        id invocatorAddress;
-        bit isManagerOperating;
+        logError_output errorLogged;
         bit orderFound;
+        uint64 slot;
+        loadOrder_input loadInput;
+        loadOrder_output loadOutput;
         BridgeOrder order;
-        TokensLogger logTokens;
+        OrderEventLogger event;
+        uint64 statsIndex;
+        bit payout;
+        unlinkPending_input pendingInput;
+        unlinkPending_output pendingOutput;
     };
 
-    // Complete an order and release tokens
-    PUBLIC_PROCEDURE_WITH_LOCALS(completeOrder)
-        locals.invocatorAddress = qpi.invocator();
-        locals.isManagerOperating = false;
-        CALL(isManager, locals.invocatorAddress, locals.isManagerOperating);
+    PRIVATE_PROCEDURE_WITH_LOCALS(processRefund)
+        output.amount = 0;
 
-        //Check if the order is handled by a manager
-        locals.orderFound = false;
-        for (uint64 i = 0; i < state.orders.capacity(); ++i) {
-            if (state.orders.get(i).orderId == input.orderId) {
-                locals.order = state.orders.get(i);
-                locals.orderFound = true;
-                break;
-            }
+        // Retrieve the order
+        locals.orderFound = state.orderIndex.get(input.orderId, locals.slot);
+        if (locals.orderFound) {
+            locals.loadInput.slot = locals.slot;
+            CALL(loadOrder, locals.loadInput, locals.loadOutput);
+            locals.order = locals.loadOutput.order;
         }
 
         // Order nor found
@@ -498,14 +2301,14 @@ public:
                 0,
                 0
             };
-            LOG_INFO(locals.log);
+            CALL(logError, locals.log, locals.errorLogged);
             output.status = 2; // Error
             return;
         }
 
         // Check order status
         // All orders status are 0 when created
-        if (locals.order.status != 0) { //Check it is not completed or refunded already
+        if ((locals.order.flags & ETHBRIDGE_ORDER_STATUS_MASK) != ETHBRIDGE_ORDER_CREATED) { //Check it is not completed or refunded already
             locals.log = EthBridgeLogger{
                 CONTRACT_INDEX,
                 EthBridgeError::invalidOrderState,
@@ -513,100 +2316,105 @@ public:
                 0,
                 0
             };
-            LOG_INFO(locals.log);
+            CALL(logError, locals.log, locals.errorLogged);
             output.status = 3; // Error
             return;
         }
 
-        // Handle order based on transfer direction
-        if (locals.order.fromQubicToEthereum) {
-            // Ensure sufficient tokens were transferred to the contract
-            if (state.totalReceivedTokens - state.lockedTokens < locals.order.amount) {
-                locals.log = EthBridgeLogger{
-                    CONTRACT_INDEX,
-                    EthBridgeError::insufficientLockedTokens,
-                    input.orderId,
-                    locals.order.amount,
-                    0
-                };
-                LOG_INFO(locals.log);
-                output.status = 4; // Error
-                return;
-            }
+        // The expiry sweep only pays back deposits bound to the order. Other
+        // orders never handed their amount to the contract, so they are
+        // closed without moving any tokens.
+        locals.payout = !input.expired || (locals.order.flags & ETHBRIDGE_ORDER_DEPOSIT_BOUND) != 0;
 
-            state.lockedTokens += locals.order.amount; //increase the amount of locked tokens
-            state.totalReceivedTokens -= locals.order.amount; //decrease the amount of no-locked (received) tokens
-            locals.logTokens = TokensLogger{
+        // Make sure the payout cannot fail once the order is marked refunded
+        if (locals.payout && locals.order.amount > input.availableBalance) {
+            locals.log = EthBridgeLogger{
                 CONTRACT_INDEX,
-                state.lockedTokens,
-                state.totalReceivedTokens,
+                EthBridgeError::transferFailed,
+                input.orderId,
+                locals.order.amount,
                 0
             };
-
-            LOG_INFO(locals.logTokens);
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 4; // Error
+            return;
         }
-        else {
-            // Ensure sufficient tokens are locked for the order
-            if (state.lockedTokens < locals.order.amount) {
-                locals.log = EthBridgeLogger{
-                    CONTRACT_INDEX,
-                    EthBridgeError::insufficientLockedTokens,
-                    input.orderId,
-                    locals.order.amount,
-                    0
-                };
-                LOG_INFO(locals.log);
-                output.status = 5; // Error
-                return;
-            }
 
-            // Transfer tokens back to the user
-            if (qpi.transfer(locals.order.qubicSender, locals.order.amount) < 0) {
-                locals.log = EthBridgeLogger{
-                    CONTRACT_INDEX,
-                    EthBridgeError::transferFailed,
-                    input.orderId,
-                    locals.order.amount,
-                    0
-                };
-                LOG_INFO(locals.log);
-                output.status = 6; // Error
-                return;
-            }
+        if (locals.payout && !(locals.order.flags & ETHBRIDGE_ORDER_DEPOSIT_BOUND) && state.lockedTokens < locals.order.amount) {
+            locals.log = EthBridgeLogger{
+                CONTRACT_INDEX,
+                EthBridgeError::insufficientLockedTokens,
+                input.orderId,
+                locals.order.amount,
+                0
+            };
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 6; // Error
+            return;
+        }
 
+        // Update the status and unlock tokens; a bound deposit was never locked
+        if (!locals.payout) {
+            locals.order.flags |= ETHBRIDGE_ORDER_EXPIRED;
+        }
+        else if (locals.order.flags & ETHBRIDGE_ORDER_DEPOSIT_BOUND) {
+            state.orderDeposits -= locals.order.amount;
+        }
+        else {
             state.lockedTokens -= locals.order.amount;
-            locals.logTokens = TokensLogger{
+        }
+        locals.order.flags = (uint8)((locals.order.flags & ~ETHBRIDGE_ORDER_STATUS_MASK) | ETHBRIDGE_ORDER_REFUNDED);
+        locals.order.finishedEpoch = qpi.epoch();
+        locals.order.finishedTick = qpi.tick();
+        state.orderFlags.set(locals.slot, locals.order.flags);
+        state.orderFinishedEpochs.set(locals.slot, locals.order.finishedEpoch);
+        state.orderFinishedTicks.set(locals.slot, locals.order.finishedTick);
+        state.finishedPerBlock.set(locals.slot >> ETHBRIDGE_SWEEP_BLOCK_BITS, state.finishedPerBlock.get(locals.slot >> ETHBRIDGE_SWEEP_BLOCK_BITS) + 1);
+
+        locals.pendingInput.slot = locals.slot;
+        locals.pendingInput.fromQubicToEthereum = (locals.order.flags & ETHBRIDGE_ORDER_TO_ETHEREUM) != 0;
+        CALL(unlinkPending, locals.pendingInput, locals.pendingOutput);
+
+        locals.statsIndex = (ETHBRIDGE_ORDER_CREATED << 1) | (locals.pendingInput.fromQubicToEthereum ? 1 : 0);
+        state.orderCounts.set(locals.statsIndex, state.orderCounts.get(locals.statsIndex) - 1);
+        locals.statsIndex = (ETHBRIDGE_ORDER_REFUNDED << 1) | (locals.pendingInput.fromQubicToEthereum ? 1 : 0);
+        state.orderCounts.set(locals.statsIndex, state.orderCounts.get(locals.statsIndex) + 1);
+        locals.statsIndex = locals.pendingInput.fromQubicToEthereum ? 1 : 0;
+        state.pendingAmounts.set(locals.statsIndex, state.pendingAmounts.get(locals.statsIndex) - locals.order.amount);
+
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_STATE) {
+            locals.event = OrderEventLogger{
                 CONTRACT_INDEX,
-                state.lockedTokens,
-                state.totalReceivedTokens,
+                locals.payout ? EthBridgeEvent::orderRefunded : EthBridgeEvent::orderExpired,
+                locals.order.orderId,
+                locals.order.qubicSender,
+                id(locals.order.ethAddressLow, locals.order.ethAddressMid, locals.order.ethAddressHigh, 0),
+                locals.order.amount,
+                qpi.tick(),
+                locals.pendingInput.fromQubicToEthereum,
                 0
             };
-
-            LOG_INFO(locals.logTokens);
+            LOG_INFO(locals.event);
         }
 
-        // Mark the order as completed
-        locals.order.status = 1; // Completed
-        state.orders.set(locals.order.orderId, locals.order);
-
         output.status = 0; // Success
-        locals.log = EthBridgeLogger{
-            CONTRACT_INDEX,
-            0, // No error
-            input.orderId,
-            locals.order.amount,
-            0
-        };
-        LOG_INFO(locals.log);
+        output.recipient = locals.order.qubicSender;
+        output.amount = locals.payout ? locals.order.amount : 0;
     _
 
+public:
     // Refund an order and unlock tokens
     struct refundOrder_locals {
         EthBridgeLogger log;
+        logError_output errorLogged;
         id invocatorAddress;
         bit isManagerOperating;
-        bit orderFound;
-        BridgeOrder order;
+        ::Entity contractEntity;
+        sint64 availableBalance;
+        processRefund_input refundInput;
+        processRefund_output refundOutput;
+        checkShard_input shardInput;
+        checkShard_output shardOutput;
     };
 
     PUBLIC_PROCEDURE_WITH_LOCALS(refundOrder)
@@ -617,77 +2425,147 @@ public:
         if (!locals.isManagerOperating) {
             locals.log = EthBridgeLogger{
                 CONTRACT_INDEX,
-                EthBridgeError::orderNotFound,
+                EthBridgeError::onlyManagersCanCompleteOrders,
                 input.orderId,
                 0, // No amount involved
                 0
             };
-            LOG_INFO(locals.log);
+            CALL(logError, locals.log, locals.errorLogged);
             output.status = 1; // Error
             return;
         }
 
-        // Retrieve the order
-        //Check if the order is handled by a manager
-        locals.orderFound = false;
-        for (uint64 i = 0; i < state.orders.capacity(); ++i) {
-            if (state.orders.get(i).orderId == input.orderId) {
-                locals.order = state.orders.get(i);
-                locals.orderFound = true;
-                break;
-            }
+        locals.shardInput.orderId = input.orderId;
+        locals.shardInput.manager = locals.invocatorAddress;
+        CALL(checkShard, locals.shardInput, locals.shardOutput);
+        if (!locals.shardOutput.allowed) {
+            output.status = 5; // Error
+            return;
         }
 
-        // Order nor found
-        if (!locals.orderFound) {
+        qpi.getEntity(SELF, locals.contractEntity);
+        locals.availableBalance = locals.contractEntity.incomingAmount - locals.contractEntity.outgoingAmount - (sint64)state.queuedPayoutTotal;
+        locals.refundInput.orderId = input.orderId;
+        locals.refundInput.expired = false;
+        locals.refundInput.availableBalance = (locals.availableBalance > 0) ? locals.availableBalance : 0;
+        CALL(processRefund, locals.refundInput, locals.refundOutput);
+        output.status = locals.refundOutput.status;
+        if (output.status != 0) {
+            return;
+        }
+
+        // Refund tokens
+        qpi.transfer(locals.refundOutput.recipient, locals.refundOutput.amount);
+    _
+
+    struct refundOrders_locals {
+        EthBridgeLogger log;
+        logError_output errorLogged;
+        id invocatorAddress;
+        bit isManagerOperating;
+        ::Entity contractEntity;
+        sint64 availableBalance;
+        processRefund_input refundInput;
+        processRefund_output refundOutput;
+        HashMap<id, uint64, 64> payouts;     // Refund total per recipient
+        uint64 payout;
+        checkShard_input shardInput;
+        checkShard_output shardOutput;
+        TokensLogger logTokens;
+        uint64 i;
+    };
+
+    // Refund a batch of orders, paying each distinct sender with a single transfer
+    PUBLIC_PROCEDURE_WITH_LOCALS(refundOrders)
+        output.refundedCount = 0;
+        output.totalReleased = 0;
+
+        locals.invocatorAddress = qpi.invocator();
+        locals.isManagerOperating = false;
+        CALL(isManager, locals.invocatorAddress, locals.isManagerOperating);
+
+        if (!locals.isManagerOperating) {
             locals.log = EthBridgeLogger{
                 CONTRACT_INDEX,
-                EthBridgeError::orderNotFound,
-                input.orderId,
-                0,
+                EthBridgeError::onlyManagersCanCompleteOrders,
+                0, // No order ID involved
+                0, // No amount involved
                 0
             };
-            LOG_INFO(locals.log);
-            output.status = 2; // Error
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 1; // Error
             return;
         }
 
-        // Check order status
-        // All orders status are 0 when created
-        if (locals.order.status != 0) { //Check it is not completed or refunded already
+        if (input.orderCount > input.orderIds.capacity()) {
             locals.log = EthBridgeLogger{
                 CONTRACT_INDEX,
-                EthBridgeError::invalidOrderState,
-                input.orderId,
-                0,
+                EthBridgeError::invalidBatchSize,
+                0, // No order ID involved
+                input.orderCount,
                 0
             };
-            LOG_INFO(locals.log);
-            output.status = 3; // Error
+            CALL(logError, locals.log, locals.errorLogged);
+            output.status = 2; // Error
             return;
         }
 
-        // Update the status and refund tokens
-        qpi.transfer(locals.order.qubicSender, locals.order.amount);
-        state.lockedTokens -= locals.order.amount;
-        locals.order.status = 2; // Refunded
-        state.orders.set(locals.order.orderId, locals.order);
+        qpi.getEntity(SELF, locals.contractEntity);
+        locals.availableBalance = locals.contractEntity.incomingAmount - locals.contractEntity.outgoingAmount - (sint64)state.queuedPayoutTotal;
+        locals.payouts.reset();
+
+        // A failing order only sets its own status, the rest of the batch goes on
+        locals.shardInput.manager = locals.invocatorAddress;
+        locals.refundInput.expired = false;
+        for (locals.i = 0; locals.i < input.orderCount; ++locals.i) {
+            locals.shardInput.orderId = input.orderIds.get(locals.i);
+            CALL(checkShard, locals.shardInput, locals.shardOutput);
+            if (!locals.shardOutput.allowed) {
+                output.orderStatus.set(locals.i, 5); // Error
+                continue;
+            }
+
+            locals.refundInput.orderId = input.orderIds.get(locals.i);
+            locals.refundInput.availableBalance = (locals.availableBalance > 0) ? locals.availableBalance : 0;
+            CALL(processRefund, locals.refundInput, locals.refundOutput);
+            output.orderStatus.set(locals.i, locals.refundOutput.status);
+            if (locals.refundOutput.status != 0) {
+                continue;
+            }
+
+            locals.payout = 0;
+            locals.payouts.get(locals.refundOutput.recipient, locals.payout);
+            locals.payouts.set(locals.refundOutput.recipient, locals.payout + locals.refundOutput.amount);
+            locals.availableBalance -= locals.refundOutput.amount;
+            ++output.refundedCount;
+            output.totalReleased += locals.refundOutput.amount;
+        }
+
+        // One transfer per distinct recipient
+        for (locals.i = 0; locals.i < locals.payouts.capacity(); ++locals.i) {
+            if (!locals.payouts.isEmptySlot(locals.i)) {
+                qpi.transfer(locals.payouts.key(locals.i), locals.payouts.value(locals.i));
+            }
+        }
 
-        locals.log = EthBridgeLogger{
-            CONTRACT_INDEX,
-            0, // No error
-            input.orderId,
-            locals.order.amount,
-            0
-        };
-        LOG_INFO(locals.log);
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_STATE && output.refundedCount > 0) {
+            locals.logTokens = TokensLogger{
+                CONTRACT_INDEX,
+                state.lockedTokens,
+                state.totalReceivedTokens,
+                0
+            };
+            LOG_INFO(locals.logTokens);
+        }
         output.status = 0; // Success
     _
 
     // Transfer tokens to the contract
     struct transferToContract_locals {
         EthBridgeLogger log;
+        logError_output errorLogged;
         TokensLogger logTokens;
+        OrderEventLogger event;
     };
 
     PUBLIC_PROCEDURE_WITH_LOCALS(transferToContract)
@@ -700,7 +2578,7 @@ public:
                 input.amount,
                 0
             };
-            LOG_INFO(locals.log);
+            CALL(logError, locals.log, locals.errorLogged);
             output.status = 1; // Error
             return;
         }
@@ -715,29 +2593,37 @@ public:
                 input.amount,
                 0
             };
-            LOG_INFO(locals.log);
+            CALL(logError, locals.log, locals.errorLogged);
             return;
         }
 
         // Update the total received tokens
         state.totalReceivedTokens += input.amount;
-        locals.logTokens = TokensLogger{
-            CONTRACT_INDEX,
-            state.lockedTokens,
-            state.totalReceivedTokens,
-            0
-        };
-
-        LOG_INFO(locals.logTokens);
-
-        locals.log = EthBridgeLogger{
-            CONTRACT_INDEX,
-            0, // No error
-            0, // No order ID
-            input.amount,
-            0
-        };
-        LOG_INFO(locals.log);
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_VERBOSE) {
+            locals.logTokens = TokensLogger{
+                CONTRACT_INDEX,
+                state.lockedTokens,
+                state.totalReceivedTokens,
+                0
+            };
+
+            LOG_INFO(locals.logTokens);
+        }
+
+        if (ETHBRIDGE_LOG_LEVEL >= ETHBRIDGE_LOG_STATE) {
+            locals.event = OrderEventLogger{
+                CONTRACT_INDEX,
+                EthBridgeEvent::deposit,
+                0, // No order ID
+                qpi.invocator(),
+                SELF,
+                input.amount,
+                qpi.tick(),
+                true,
+                0
+            };
+            LOG_INFO(locals.event);
+        }
         output.status = 0; // Success
     _
 
@@ -767,15 +2653,285 @@ public:
         REGISTER_USER_FUNCTION(getAdminID, 12);
         REGISTER_USER_FUNCTION(getInvocatorID, 13)
         REGISTER_USER_FUNCTION(getTotalLockedTokens, 14);
+
+        REGISTER_USER_PROCEDURE(completeOrders, 15);
+        REGISTER_USER_PROCEDURE(refundOrders, 16);
+        REGISTER_USER_PROCEDURE(createOrders, 17);
+        REGISTER_USER_FUNCTION(getOrders, 18);
+        REGISTER_USER_FUNCTION(getPendingOrders, 19);
+        REGISTER_USER_FUNCTION(getOrdersBySender, 20);
+        REGISTER_USER_PROCEDURE(setRetentionEpochs, 21);
+        REGISTER_USER_FUNCTION(getRetiredSummary, 22);
+        REGISTER_USER_FUNCTION(getStats, 23);
+        REGISTER_USER_FUNCTION(getLatencyHistogram, 24);
+        REGISTER_USER_FUNCTION(getOrdersByIds, 25);
+        REGISTER_USER_PROCEDURE(setPayoutMode, 26);
+        REGISTER_USER_FUNCTION(getPayoutQueue, 27);
+        REGISTER_USER_FUNCTION(getBatch, 28);
+        REGISTER_USER_PROCEDURE(setOrderTimeout, 29);
+        REGISTER_USER_FUNCTION(getNextOrdersByPriority, 30);
+        REGISTER_USER_PROCEDURE(setShardOwner, 31);
+        REGISTER_USER_FUNCTION(getShardOwners, 32);
+        REGISTER_USER_FUNCTION(getPendingOrdersForManager, 33);
     _
 
     // Initialize the contract
-    INITIALIZE
+    struct INITIALIZE_locals {
+        uint64 i;
+        struct {
+            id left;
+            id right;
+        } node;
+    };
+
+    INITIALIZE_WITH_LOCALS
         state.nextOrderId = 0;
         state.lockedTokens = 0;
         state.totalReceivedTokens = 0;
+        state.orderDeposits = 0;
         state.transactionFee = 1000;
         state.admin = qpi.invocator();
+        state.managers.reset();
+        state.senderOrders.reset();
+        state.priorityOrders.reset();
+        for (locals.i = 0; locals.i < state.shardOwners.capacity(); ++locals.i) {
+            state.shardOwners.set(locals.i, NULL_ID);
+        }
+        state.retentionEpochs = 2;
+        state.deferPayouts = false;
+        state.payoutsPerTick = 16;
+        state.queuedPayouts.reset();
+        state.payoutQueueHead = 0;
+        state.payoutQueueCount = 0;
+        state.queuedPayoutTotal = 0;
+        state.openBatch.orderCount = 0;
+        state.openBatch.totalAmount = 0;
+        state.batchCount = 0;
+        state.orderTimeoutTicks = 0;
+        state.expiredOrders = 0;
+
+        // Roots of empty batch subtrees: an empty leaf is NULL_ID
+        state.batchZeroHashes.set(0, NULL_ID);
+        for (locals.i = 1; locals.i < ETHBRIDGE_BATCH_TREE_DEPTH; ++locals.i) {
+            locals.node.left = state.batchZeroHashes.get(locals.i - 1);
+            locals.node.right = locals.node.left;
+            state.batchZeroHashes.set(locals.i, qpi.K12(locals.node));
+        }
         state.sourceChain = 0; //Arbitrary numb. No-EVM chain
+
+        // Mark every slot as empty and push them on the free stack so that
+        // slot 0 is handed out first
+        state.freeSlotCount = 0;
+        for (locals.i = state.orderFlags.capacity(); locals.i > 0; --locals.i) {
+            state.orderFlags.set(locals.i - 1, ETHBRIDGE_ORDER_EMPTY);
+            state.freeSlots.set(state.freeSlotCount++, locals.i - 1);
+            state.pendingPrev.set(locals.i - 1, NULL_INDEX);
+            state.pendingNext.set(locals.i - 1, NULL_INDEX);
+        }
+        for (locals.i = 0; locals.i < state.pendingHead.capacity(); ++locals.i) {
+            state.pendingHead.set(locals.i, NULL_INDEX);
+            state.pendingTail.set(locals.i, NULL_INDEX);
+            state.pendingCount.set(locals.i, 0);
+            state.pendingAmounts.set(locals.i, 0);
+            state.totalLatencyTicks.set(locals.i, 0);
+            state.completedCount.set(locals.i, 0);
+        }
+        for (locals.i = 0; locals.i < state.latencyHistogram.capacity(); ++locals.i) {
+            state.latencyHistogram.set(locals.i, 0);
+        }
+        for (locals.i = 0; locals.i < state.orderCounts.capacity(); ++locals.i) {
+            state.orderCounts.set(locals.i, 0);
+        }
+        for (locals.i = 0; locals.i < state.errorCounts.capacity(); ++locals.i) {
+            state.errorCounts.set(locals.i, 0);
+        }
+        for (locals.i = 0; locals.i < state.finishedPerBlock.capacity(); ++locals.i) {
+            state.finishedPerBlock.set(locals.i, 0);
+        }
+    _
+
+    // Retire finished orders that are older than the retention period and
+    // hand their slots back to the allocator
+    struct END_EPOCH_locals {
+        loadOrder_input loadInput;
+        loadOrder_output loadOutput;
+        BridgeOrder order;
+        sint64 elementIndex;
+        struct {
+            id previous;
+            BridgeOrder order;
+        } digestInput;
+        uint64 retiredCount;
+        uint64 block;
+        uint64 slot;
+        uint16 epoch;
+        uint8 status;
+        uint64 statsIndex;
+        bit retire;
+    };
+
+    END_EPOCH_WITH_LOCALS
+        locals.retiredCount = 0;
+        locals.epoch = qpi.epoch();
+
+        for (locals.block = 0; locals.block < state.finishedPerBlock.capacity(); ++locals.block) {
+            // Only blocks holding finished orders can have anything to retire
+            if (state.finishedPerBlock.get(locals.block) == 0) {
+                continue;
+            }
+
+            for (locals.slot = locals.block << ETHBRIDGE_SWEEP_BLOCK_BITS; locals.slot < (locals.block << ETHBRIDGE_SWEEP_BLOCK_BITS) + ETHBRIDGE_SWEEP_BLOCK; ++locals.slot) {
+                locals.status = state.orderFlags.get(locals.slot) & ETHBRIDGE_ORDER_STATUS_MASK;
+                locals.retire = (locals.status == ETHBRIDGE_ORDER_COMPLETED || locals.status == ETHBRIDGE_ORDER_REFUNDED)
+                    && (uint16)(locals.epoch - state.orderFinishedEpochs.get(locals.slot)) >= state.retentionEpochs;
+                if (!locals.retire) {
+                    continue;
+                }
+
+                locals.loadInput.slot = locals.slot;
+                CALL(loadOrder, locals.loadInput, locals.loadOutput);
+                locals.order = locals.loadOutput.order;
+
+                // Drop the order from the lookup and sender indexes
+                state.orderIndex.removeByKey(locals.order.orderId);
+                locals.elementIndex = state.senderOrders.headIndex(locals.order.qubicSender, locals.order.orderId);
+                if (locals.elementIndex != NULL_INDEX && state.senderOrders.element(locals.elementIndex) == locals.slot) {
+                    state.senderOrders.remove(locals.elementIndex);
+                }
+
+                // Fold the order into the audit summary
+                locals.digestInput.previous = state.retired.digest;
+                locals.digestInput.order = locals.order;
+                state.retired.digest = qpi.K12(locals.digestInput);
+                ++state.retired.orderCount;
+                if (locals.status == ETHBRIDGE_ORDER_COMPLETED) {
+                    state.retired.completedAmount += locals.order.amount;
+                }
+                else if (!(locals.order.flags & ETHBRIDGE_ORDER_EXPIRED)) {
+                    state.retired.refundedAmount += locals.order.amount;
+                }
+                if (locals.order.orderId > state.retired.lastOrderId) {
+                    state.retired.lastOrderId = locals.order.orderId;
+                }
+
+                locals.statsIndex = (locals.status << 1) | ((locals.order.flags & ETHBRIDGE_ORDER_TO_ETHEREUM) ? 1 : 0);
+                state.orderCounts.set(locals.statsIndex, state.orderCounts.get(locals.statsIndex) - 1);
+
+                // Return the slot to the allocator
+                state.orderFlags.set(locals.slot, ETHBRIDGE_ORDER_EMPTY);
+                state.finishedPerBlock.set(locals.block, state.finishedPerBlock.get(locals.block) - 1);
+                state.freeSlots.set(state.freeSlotCount++, locals.slot);
+                ++locals.retiredCount;
+            }
+        }
+
+        if (locals.retiredCount > 0) {
+            state.retired.lastEpoch = locals.epoch;
+            state.orderIndex.cleanupIfNeeded();
+            state.senderOrders.cleanupIfNeeded();
+        }
+    _
+
+    // Finalize the batch commitment of this tick, refund expired orders,
+    // then settle queued payouts, oldest recipient first, within the
+    // per-tick transfer budget
+    struct END_TICK_locals {
+        closeBatch_input closeInput;
+        closeBatch_output closeOutput;
+        ::Entity contractEntity;
+        sint64 availableBalance;
+        bit balanceLoaded;
+        sint64 head;
+        uint32 tick;
+        processRefund_input refundInput;
+        processRefund_output refundOutput;
+        uint64 steps;
+        EthBridgeLogger log;
+        logError_output errorLogged;
+        id recipient;
+        uint64 payout;
+        uint64 transfers;
+    };
+
+    END_TICK_WITH_LOCALS
+        CALL(closeBatch, locals.closeInput, locals.closeOutput);
+
+        // Expiry of Qubic -> Ethereum orders: their pending queue is in
+        // creation order, so expired orders are always at its head. Close up
+        // to ETHBRIDGE_EXPIRY_PER_TICK of them: bound deposits are refunded,
+        // other orders are marked expired without a payout. A refund that
+        // cannot be paid blocks the queue until the next tick.
+        // Ethereum -> Qubic orders never expire: their tokens may already be
+        // burned on Ethereum, so they stay pending for the managers.
+        if (state.orderTimeoutTicks > 0) {
+            locals.tick = qpi.tick();
+            locals.balanceLoaded = false;
+            locals.refundInput.expired = true;
+            for (locals.steps = 0; locals.steps < ETHBRIDGE_EXPIRY_PER_TICK; ++locals.steps) {
+                locals.head = state.pendingHead.get(1);
+                if (locals.head == NULL_INDEX
+                    || locals.tick - state.orderCreatedTicks.get(locals.head) < state.orderTimeoutTicks) {
+                    break;
+                }
+
+                if (!locals.balanceLoaded) {
+                    qpi.getEntity(SELF, locals.contractEntity);
+                    locals.availableBalance = locals.contractEntity.incomingAmount - locals.contractEntity.outgoingAmount - (sint64)state.queuedPayoutTotal;
+                    locals.balanceLoaded = true;
+                }
+                locals.refundInput.orderId = state.orderIds.get(locals.head);
+                locals.refundInput.availableBalance = (locals.availableBalance > 0) ? locals.availableBalance : 0;
+                CALL(processRefund, locals.refundInput, locals.refundOutput);
+                if (locals.refundOutput.status != 0) {
+                    break;
+                }
+
+                if (locals.refundOutput.amount > 0) {
+                    qpi.transfer(locals.refundOutput.recipient, locals.refundOutput.amount);
+                    locals.availableBalance -= locals.refundOutput.amount;
+                }
+                ++state.expiredOrders;
+            }
+        }
+
+        // The SELF PoV is marked for removal whenever the lane runs empty, so
+        // tidy the priority lane once per tick, after this tick's removals
+        state.priorityOrders.cleanupIfNeeded();
+
+        for (locals.transfers = 0; locals.transfers < state.payoutsPerTick && state.payoutQueueCount > 0; ++locals.transfers) {
+            locals.recipient = state.payoutQueue.get(state.payoutQueueHead);
+            locals.payout = 0;
+            state.queuedPayouts.get(locals.recipient, locals.payout);
+
+            // Keep the recipient at the head of the queue and retry next tick
+            if (qpi.transfer(locals.recipient, locals.payout) < 0) {
+                locals.log = EthBridgeLogger{
+                    CONTRACT_INDEX,
+                    EthBridgeError::transferFailed,
+                    0, // No order ID involved
+                    locals.payout,
+                    0
+                };
+                CALL(logError, locals.log, locals.errorLogged);
+                break;
+            }
+
+            state.queuedPayouts.removeByKey(locals.recipient);
+            state.queuedPayoutTotal -= locals.payout;
+            state.payoutQueueHead = (state.payoutQueueHead + 1) & (ETHBRIDGE_MAX_ORDERS - 1);
+            --state.payoutQueueCount;
+        }
+
+        if (locals.transfers > 0) {
+            state.queuedPayouts.cleanupIfNeeded();
+        }
     _
-};
\ No newline at end of file
+};
+
+static_assert(sizeof(ETHBRIDGE) <= ETHBRIDGE_MAX_STATE_SIZE, "ETHBRIDGE state exceeds the contract state budget");
+static_assert(sizeof(ETHBRIDGE::OrderParties) == 56, "OrderParties must stay packed");
+static_assert(sizeof(ETHBRIDGE::BatchLeaf) == 40, "BatchLeaf layout is part of the batch commitment");
+static_assert((ETHBRIDGE_BATCH_HISTORY & (ETHBRIDGE_BATCH_HISTORY - 1)) == 0, "ETHBRIDGE_BATCH_HISTORY must be a power of 2");
+static_assert(ETHBRIDGE_ORDER_STATUS_MASK == 0x03 && (ETHBRIDGE_ORDER_EMPTY & ~ETHBRIDGE_ORDER_STATUS_MASK) == 0,
+    "Order status codes must fit in the status bits of BridgeOrder::flags");
+static_assert(ETHBRIDGE::EthBridgeError::indexFull < 16, "errorCounts needs one entry per EthBridgeError code");
\ No newline at end of file
@@ -0,0 +1,1283 @@
+#define NO_UEFI
+
+#include "contract_testing.h"
+
+static const id ADMIN(1, 0, 0, 0);
+static const id MANAGER(2, 0, 0, 0);
+static const id USER1(3, 0, 0, 0);
+static const id USER2(4, 0, 0, 0);
+static const id MANAGER2(5, 0, 0, 0);
+static const id ETHBRIDGE_ID(ETHBRIDGE_CONTRACT_INDEX, 0, 0, 0);
+static const id ETH_ADDRESS(0x0102030405060708ULL, 0x1112131415161718ULL, 0x21222324ULL, 0);
+
+static constexpr uint64 TRANSACTION_FEE = 1000;
+
+// Orders used by the batch tests: order i goes to a distinct EVM address
+// that fills all 20 address bytes of its leaf
+static id batchTestAddress(uint64 orderId)
+{
+    return id(0x0102030405060708ULL + orderId, 0x1112131415161718ULL, 0x21222324ULL, 0);
+}
+
+static uint64 batchTestAmount(uint64 orderId)
+{
+    return 1000 + orderId;
+}
+
+static id hashNode(const id& left, const id& right)
+{
+    id node[2] = { left, right };
+    id digest;
+    KangarooTwelve((unsigned char*)node, sizeof(node), (unsigned char*)&digest, sizeof(digest));
+    return digest;
+}
+
+// Root of an empty subtree of the given height, built up from NULL_ID leaves
+static id zeroSubtreeRoot(uint64 height)
+{
+    id hash = NULL_ID;
+    for (uint64 i = 0; i < height; ++i)
+    {
+        hash = hashNode(hash, hash);
+    }
+    return hash;
+}
+
+// Reference root of the batch test orders 0 .. orderCount - 1, computed level
+// by level over the whole tree, independently of the contract's incremental
+// branch algorithm
+static id batchTestRoot(uint64 orderCount)
+{
+    std::vector<id> level;
+    for (uint64 i = 0; i < orderCount; ++i)
+    {
+        ETHBRIDGE::BatchLeaf leaf;
+        const id address = batchTestAddress(i);
+        leaf.orderId = i;
+        leaf.amount = batchTestAmount(i);
+        leaf.ethAddressLow = address.u64._0;
+        leaf.ethAddressMid = address.u64._1;
+        leaf.ethAddressHigh = address.u32._4;
+        leaf.reserved = 0;
+        id hash;
+        KangarooTwelve((unsigned char*)&leaf, sizeof(leaf), (unsigned char*)&hash, sizeof(hash));
+        level.push_back(hash);
+    }
+
+    for (uint64 height = 0; height < ETHBRIDGE_BATCH_TREE_DEPTH; ++height)
+    {
+        std::vector<id> parents;
+        for (uint64 i = 0; i < level.size(); i += 2)
+        {
+            parents.push_back(hashNode(level[i], (i + 1 < level.size()) ? level[i + 1] : zeroSubtreeRoot(height)));
+        }
+        level = parents;
+    }
+    return level[0];
+}
+
+// Shard of an order ID, as assigned by the contract
+static uint64 orderShard(uint64 orderId)
+{
+    return (orderId * 0x9E3779B97F4A7C15ULL) >> (64 - ETHBRIDGE_SHARD_BITS);
+}
+
+// Gives the tests access to the contract state
+class EthBridgeChecker : public ETHBRIDGE
+{
+public:
+    void overrideAdmin(const id& newAdmin)
+    {
+        admin = newAdmin;
+    }
+
+    void overrideQueuedPayoutTotal(uint64 amount)
+    {
+        queuedPayoutTotal = amount;
+    }
+
+    id zeroHash(uint64 height) const
+    {
+        return batchZeroHashes.get(height);
+    }
+
+    void overrideOpenBatchOrderCount(uint32 orderCount)
+    {
+        openBatch.orderCount = orderCount;
+    }
+};
+
+class ContractTestingEthBridge : protected ContractTesting
+{
+public:
+    ContractTestingEthBridge()
+    {
+        initEmptySpectrum();
+        initEmptyUniverse();
+        INIT_CONTRACT(ETHBRIDGE);
+        system.epoch = 100;
+        system.tick = 1000;
+        callSystemProcedure(ETHBRIDGE_CONTRACT_INDEX, INITIALIZE);
+
+        // INITIALIZE takes the admin from the invocator, which system
+        // procedures do not have
+        getState()->overrideAdmin(ADMIN);
+        increaseEnergy(ADMIN, 1);
+        increaseEnergy(MANAGER, 1);
+        EXPECT_EQ(addManager(MANAGER), 0);
+    }
+
+    EthBridgeChecker* getState()
+    {
+        return (EthBridgeChecker*)contractStates[ETHBRIDGE_CONTRACT_INDEX];
+    }
+
+    void endEpoch()
+    {
+        callSystemProcedure(ETHBRIDGE_CONTRACT_INDEX, END_EPOCH);
+    }
+
+    void endTick()
+    {
+        callSystemProcedure(ETHBRIDGE_CONTRACT_INDEX, END_TICK);
+    }
+
+    // Invokes createOrder after funding the user with the invocation reward
+    ETHBRIDGE::createOrder_output createOrder(const id& user, const ETHBRIDGE::createOrder_input& input, sint64 reward)
+    {
+        ETHBRIDGE::createOrder_output output;
+        increaseEnergy(user, reward);
+        EXPECT_TRUE(invokeUserProcedure(ETHBRIDGE_CONTRACT_INDEX, 1, input, output, user, reward));
+        return output;
+    }
+
+    ETHBRIDGE::createOrder_output createOrder(const id& user, uint64 amount, bit fromQubicToEthereum)
+    {
+        return createOrder(user, ETHBRIDGE::createOrder_input{ ETH_ADDRESS, amount, fromQubicToEthereum, false, 0 }, TRANSACTION_FEE);
+    }
+
+    // Qubic -> Ethereum order paid for with the exact fee and deposit
+    ETHBRIDGE::createOrder_output createDepositOrder(const id& user, uint64 amount)
+    {
+        return createOrder(user, ETHBRIDGE::createOrder_input{ ETH_ADDRESS, amount, true, true, 0 }, TRANSACTION_FEE + amount);
+    }
+
+    ETHBRIDGE::createOrders_output createOrders(const id& user, const std::vector<ETHBRIDGE::OrderRequest>& orders, sint64 reward)
+    {
+        ETHBRIDGE::createOrders_input input{};
+        ETHBRIDGE::createOrders_output output;
+        for (uint64 i = 0; i < orders.size(); ++i)
+        {
+            input.orders.set(i, orders[i]);
+        }
+        input.orderCount = (uint8)orders.size();
+        increaseEnergy(user, reward);
+        EXPECT_TRUE(invokeUserProcedure(ETHBRIDGE_CONTRACT_INDEX, 17, input, output, user, reward));
+        return output;
+    }
+
+    ETHBRIDGE::getOrder_output getOrder(uint64 orderId)
+    {
+        ETHBRIDGE::getOrder_input input{ orderId };
+        ETHBRIDGE::getOrder_output output;
+        callFunction(ETHBRIDGE_CONTRACT_INDEX, 2, input, output);
+        return output;
+    }
+
+    ETHBRIDGE::getOrders_output getOrders(uint64 startOrderId, uint64 maxCount)
+    {
+        ETHBRIDGE::getOrders_input input{ startOrderId, maxCount };
+        ETHBRIDGE::getOrders_output output;
+        callFunction(ETHBRIDGE_CONTRACT_INDEX, 18, input, output);
+        return output;
+    }
+
+    ETHBRIDGE::getOrdersByIds_output getOrdersByIds(const std::vector<uint64>& orderIds)
+    {
+        ETHBRIDGE::getOrdersByIds_input input{};
+        ETHBRIDGE::getOrdersByIds_output output;
+        for (uint64 i = 0; i < orderIds.size(); ++i)
+        {
+            input.orderIds.set(i, orderIds[i]);
+        }
+        input.orderCount = (uint8)orderIds.size();
+        callFunction(ETHBRIDGE_CONTRACT_INDEX, 25, input, output);
+        return output;
+    }
+
+    ETHBRIDGE::getPendingOrders_output getPendingOrders(bit fromQubicToEthereum, uint64 maxCount = 0, bit continueAfter = false, uint64 afterOrderId = 0)
+    {
+        ETHBRIDGE::getPendingOrders_input input{ maxCount, fromQubicToEthereum, continueAfter, afterOrderId };
+        ETHBRIDGE::getPendingOrders_output output;
+        callFunction(ETHBRIDGE_CONTRACT_INDEX, 19, input, output);
+        return output;
+    }
+
+    ETHBRIDGE::getOrdersBySender_output getOrdersBySender(const id& sender, uint64 beforeOrderId, uint64 maxCount)
+    {
+        ETHBRIDGE::getOrdersBySender_input input{ sender, beforeOrderId, maxCount };
+        ETHBRIDGE::getOrdersBySender_output output;
+        callFunction(ETHBRIDGE_CONTRACT_INDEX, 20, input, output);
+        return output;
+    }
+
+    ETHBRIDGE::getNextOrdersByPriority_output getNextOrdersByPriority(uint64 maxCount)
+    {
+        ETHBRIDGE::getNextOrdersByPriority_input input{ maxCount };
+        ETHBRIDGE::getNextOrdersByPriority_output output;
+        callFunction(ETHBRIDGE_CONTRACT_INDEX, 30, input, output);
+        return output;
+    }
+
+    ETHBRIDGE::getPendingOrdersForManager_output getPendingOrdersForManager(const id& manager, bit includeUnassigned)
+    {
+        ETHBRIDGE::getPendingOrdersForManager_input input{ manager, 0, true, includeUnassigned, false, 0 };
+        ETHBRIDGE::getPendingOrdersForManager_output output;
+        callFunction(ETHBRIDGE_CONTRACT_INDEX, 33, input, output);
+        return output;
+    }
+
+    uint8 setShardOwner(uint64 shard, const id& manager, const id& invocator = ADMIN)
+    {
+        ETHBRIDGE::setShardOwner_input input{ shard, manager };
+        ETHBRIDGE::setShardOwner_output output;
+        EXPECT_TRUE(invokeUserProcedure(ETHBRIDGE_CONTRACT_INDEX, 31, input, output, invocator, 0));
+        return output.status;
+    }
+
+    ETHBRIDGE::getShardOwners_output getShardOwners()
+    {
+        ETHBRIDGE::getShardOwners_input input;
+        ETHBRIDGE::getShardOwners_output output;
+        callFunction(ETHBRIDGE_CONTRACT_INDEX, 32, input, output);
+        return output;
+    }
+
+    uint8 addManager(const id& manager, const id& invocator = ADMIN)
+    {
+        ETHBRIDGE::addManager_input input{ manager };
+        ETHBRIDGE::addManager_output output;
+        EXPECT_TRUE(invokeUserProcedure(ETHBRIDGE_CONTRACT_INDEX, 4, input, output, invocator, 0));
+        return output.status;
+    }
+
+    uint8 removeManager(const id& manager)
+    {
+        ETHBRIDGE::removeManager_input input{ manager };
+        ETHBRIDGE::removeManager_output output;
+        EXPECT_TRUE(invokeUserProcedure(ETHBRIDGE_CONTRACT_INDEX, 5, input, output, ADMIN, 0));
+        return output.status;
+    }
+
+    uint8 completeOrder(uint64 orderId, const id& invocator = MANAGER)
+    {
+        ETHBRIDGE::completeOrder_input input{ orderId };
+        ETHBRIDGE::completeOrder_output output;
+        EXPECT_TRUE(invokeUserProcedure(ETHBRIDGE_CONTRACT_INDEX, 6, input, output, invocator, 0));
+        return output.status;
+    }
+
+    ETHBRIDGE::completeOrders_output completeOrders(const std::vector<uint64>& orderIds, const id& invocator = MANAGER)
+    {
+        ETHBRIDGE::completeOrders_input input{};
+        ETHBRIDGE::completeOrders_output output;
+        for (uint64 i = 0; i < orderIds.size(); ++i)
+        {
+            input.orderIds.set(i, orderIds[i]);
+        }
+        input.orderCount = (uint8)orderIds.size();
+        EXPECT_TRUE(invokeUserProcedure(ETHBRIDGE_CONTRACT_INDEX, 15, input, output, invocator, 0));
+        return output;
+    }
+
+    uint8 refundOrder(uint64 orderId, const id& invocator = MANAGER)
+    {
+        ETHBRIDGE::refundOrder_input input{ orderId };
+        ETHBRIDGE::refundOrder_output output;
+        EXPECT_TRUE(invokeUserProcedure(ETHBRIDGE_CONTRACT_INDEX, 7, input, output, invocator, 0));
+        return output.status;
+    }
+
+    ETHBRIDGE::refundOrders_output refundOrders(const std::vector<uint64>& orderIds, const id& invocator = MANAGER)
+    {
+        ETHBRIDGE::refundOrders_input input{};
+        ETHBRIDGE::refundOrders_output output;
+        for (uint64 i = 0; i < orderIds.size(); ++i)
+        {
+            input.orderIds.set(i, orderIds[i]);
+        }
+        input.orderCount = (uint8)orderIds.size();
+        EXPECT_TRUE(invokeUserProcedure(ETHBRIDGE_CONTRACT_INDEX, 16, input, output, invocator, 0));
+        return output;
+    }
+
+    // Completing a Qubic -> Ethereum order without a deposit needs the
+    // amount twice in received tokens: it moves from received to locked
+    uint8 transferToContract(const id& user, uint64 amount)
+    {
+        ETHBRIDGE::transferToContract_input input{ amount };
+        ETHBRIDGE::transferToContract_output output;
+        increaseEnergy(user, amount);
+        EXPECT_TRUE(invokeUserProcedure(ETHBRIDGE_CONTRACT_INDEX, 8, input, output, user, amount));
+        return output.status;
+    }
+
+    // Locks amount tokens by completing a Qubic -> Ethereum order of USER2,
+    // which Ethereum -> Qubic completions and plain refunds pay out of
+    void lockTokens(uint64 amount)
+    {
+        EXPECT_EQ(transferToContract(USER2, amount), 0);
+        ETHBRIDGE::createOrder_output order = createOrder(USER2, amount, true);
+        EXPECT_EQ(order.status, 0);
+        EXPECT_EQ(completeOrder(order.orderId), 0);
+    }
+
+    uint64 getTotalLockedTokens()
+    {
+        ETHBRIDGE::getTotalLockedTokens_input input;
+        ETHBRIDGE::getTotalLockedTokens_output output;
+        callFunction(ETHBRIDGE_CONTRACT_INDEX, 14, input, output);
+        return output.totalLockedTokens;
+    }
+
+    uint8 setRetentionEpochs(uint16 epochs, const id& invocator = ADMIN)
+    {
+        ETHBRIDGE::setRetentionEpochs_input input{ epochs };
+        ETHBRIDGE::setRetentionEpochs_output output;
+        EXPECT_TRUE(invokeUserProcedure(ETHBRIDGE_CONTRACT_INDEX, 21, input, output, invocator, 0));
+        return output.status;
+    }
+
+    ETHBRIDGE::getRetiredSummary_output getRetiredSummary()
+    {
+        ETHBRIDGE::getRetiredSummary_input input;
+        ETHBRIDGE::getRetiredSummary_output output;
+        callFunction(ETHBRIDGE_CONTRACT_INDEX, 22, input, output);
+        return output;
+    }
+
+    ETHBRIDGE::getStats_output getStats()
+    {
+        ETHBRIDGE::getStats_input input;
+        ETHBRIDGE::getStats_output output;
+        callFunction(ETHBRIDGE_CONTRACT_INDEX, 23, input, output);
+        return output;
+    }
+
+    ETHBRIDGE::getLatencyHistogram_output getLatencyHistogram()
+    {
+        ETHBRIDGE::getLatencyHistogram_input input;
+        ETHBRIDGE::getLatencyHistogram_output output;
+        callFunction(ETHBRIDGE_CONTRACT_INDEX, 24, input, output);
+        return output;
+    }
+
+    uint8 setPayoutMode(bit deferred, uint64 transfersPerTick, const id& invocator = ADMIN)
+    {
+        ETHBRIDGE::setPayoutMode_input input{ deferred, transfersPerTick };
+        ETHBRIDGE::setPayoutMode_output output;
+        EXPECT_TRUE(invokeUserProcedure(ETHBRIDGE_CONTRACT_INDEX, 26, input, output, invocator, 0));
+        return output.status;
+    }
+
+    ETHBRIDGE::getPayoutQueue_output getPayoutQueue()
+    {
+        ETHBRIDGE::getPayoutQueue_input input;
+        ETHBRIDGE::getPayoutQueue_output output;
+        callFunction(ETHBRIDGE_CONTRACT_INDEX, 27, input, output);
+        return output;
+    }
+
+    ETHBRIDGE::getBatch_output getBatch(uint64 batchId)
+    {
+        ETHBRIDGE::getBatch_input input{ batchId };
+        ETHBRIDGE::getBatch_output output;
+        callFunction(ETHBRIDGE_CONTRACT_INDEX, 28, input, output);
+        return output;
+    }
+
+    // Creates and completes the batch test orders firstOrderId .. orderCount - 1
+    // within the current tick
+    void completeBatchTestOrders(uint64 firstOrderId, uint64 orderCount)
+    {
+        uint64 totalAmount = 0;
+        for (uint64 i = firstOrderId; i < orderCount; ++i)
+        {
+            totalAmount += batchTestAmount(i);
+        }
+        EXPECT_EQ(transferToContract(USER1, 2 * totalAmount), 0);
+
+        for (uint64 first = firstOrderId; first < orderCount; first += 16)
+        {
+            std::vector<ETHBRIDGE::OrderRequest> orders;
+            for (uint64 i = first; i < orderCount && i < first + 16; ++i)
+            {
+                orders.push_back(ETHBRIDGE::OrderRequest{ batchTestAddress(i), batchTestAmount(i), true });
+            }
+            ETHBRIDGE::createOrders_output output = createOrders(USER1, orders, TRANSACTION_FEE * orders.size());
+            EXPECT_EQ(output.status, 0);
+            EXPECT_EQ(output.firstOrderId, first);
+        }
+
+        for (uint64 first = firstOrderId; first < orderCount; first += 32)
+        {
+            std::vector<uint64> orderIds;
+            for (uint64 i = first; i < orderCount && i < first + 32; ++i)
+            {
+                orderIds.push_back(i);
+            }
+            ETHBRIDGE::completeOrders_output output = completeOrders(orderIds);
+            EXPECT_EQ(output.status, 0);
+            EXPECT_EQ(output.completedCount, orderIds.size());
+        }
+    }
+
+    // Completes the batch test orders in one tick and checks the batch that
+    // END_TICK finalizes against the reference root
+    void checkBatchRoot(uint64 orderCount)
+    {
+        uint64 totalAmount = 0;
+        for (uint64 i = 0; i < orderCount; ++i)
+        {
+            totalAmount += batchTestAmount(i);
+        }
+
+        system.tick = 2000;
+        completeBatchTestOrders(0, orderCount);
+        EXPECT_EQ(getBatch(0).status, 1);
+
+        endTick();
+        ETHBRIDGE::getBatch_output output = getBatch(0);
+        EXPECT_EQ(output.status, 0);
+        EXPECT_EQ(output.batchCount, 1);
+        EXPECT_EQ(output.batch.batchId, 0);
+        EXPECT_EQ(output.batch.tick, 2000);
+        EXPECT_EQ(output.batch.orderCount, orderCount);
+        EXPECT_EQ(output.batch.firstOrderId, 0);
+        EXPECT_EQ(output.batch.lastOrderId, orderCount - 1);
+        EXPECT_EQ(output.batch.totalAmount, totalAmount);
+        EXPECT_EQ(output.batch.root, batchTestRoot(orderCount));
+    }
+
+    uint8 setOrderTimeout(uint32 timeoutTicks)
+    {
+        ETHBRIDGE::setOrderTimeout_input input{ timeoutTicks };
+        ETHBRIDGE::setOrderTimeout_output output;
+        EXPECT_TRUE(invokeUserProcedure(ETHBRIDGE_CONTRACT_INDEX, 29, input, output, ADMIN, 0));
+        return output.status;
+    }
+};
+
+TEST(ContractEthBridge, GetOrderLooksUpOrderId)
+{
+    ContractTestingEthBridge bridge;
+
+    for (uint64 i = 0; i < 3; ++i)
+    {
+        ETHBRIDGE::createOrder_output created = bridge.createOrder(USER1, 100 + i, true);
+        EXPECT_EQ(created.status, 0);
+        EXPECT_EQ(created.orderId, i);
+    }
+
+    ETHBRIDGE::getOrder_output output = bridge.getOrder(1);
+    EXPECT_EQ(output.status, 0);
+    EXPECT_EQ(output.order.orderId, 1);
+    EXPECT_EQ(output.order.amount, 101);
+    EXPECT_EQ(output.order.originAccount, USER1);
+    EXPECT_EQ(output.order.destinationAccount, ETH_ADDRESS);
+    EXPECT_EQ(output.order.status, 0);
+    EXPECT_TRUE(output.order.fromQubicToEthereum);
+
+    EXPECT_EQ(bridge.getOrder(3).status, 1);
+}
+
+TEST(ContractEthBridge, CompleteAndRefundLookUpOrderId)
+{
+    ContractTestingEthBridge bridge;
+
+    EXPECT_EQ(bridge.transferToContract(USER1, 800), 0);
+    EXPECT_EQ(bridge.createOrder(USER1, 500, true).orderId, 0);
+    EXPECT_EQ(bridge.createOrder(USER1, 300, true).orderId, 1);
+    EXPECT_EQ(bridge.createOrder(USER2, 200, false).orderId, 2);
+
+    // Completing order 0 locks its tokens, which pay for the refund of
+    // order 1 and the Ethereum -> Qubic order 2
+    EXPECT_EQ(bridge.completeOrder(0), 0);
+    const sint64 user1Balance = getBalance(USER1);
+    EXPECT_EQ(bridge.refundOrder(1), 0);
+    EXPECT_EQ(getBalance(USER1), user1Balance + 300);
+    const sint64 user2Balance = getBalance(USER2);
+    EXPECT_EQ(bridge.completeOrder(2), 0);
+    EXPECT_EQ(getBalance(USER2), user2Balance + 200);
+
+    EXPECT_EQ(bridge.getOrder(0).order.status, 1);
+    EXPECT_EQ(bridge.getOrder(1).order.status, 2);
+    EXPECT_EQ(bridge.getOrder(2).order.status, 1);
+
+    // Finished and unknown orders
+    EXPECT_EQ(bridge.completeOrder(0), 3);
+    EXPECT_EQ(bridge.refundOrder(1), 3);
+    EXPECT_EQ(bridge.completeOrder(5), 2);
+    EXPECT_EQ(bridge.refundOrder(5), 2);
+}
+
+TEST(ContractEthBridge, CreateOrderFailsWhenTableIsFull)
+{
+    ContractTestingEthBridge bridge;
+
+    for (uint64 i = 0; i < ETHBRIDGE_MAX_ORDERS; ++i)
+    {
+        ETHBRIDGE::createOrder_output created = bridge.createOrder(USER1, 1 + i, true);
+        EXPECT_EQ(created.status, 0);
+        EXPECT_EQ(created.orderId, i);
+    }
+
+    EXPECT_EQ(bridge.createOrder(USER1, 1, true).status, 3);
+
+    // Every stored order is still found in its own slot
+    for (uint64 i = 0; i < ETHBRIDGE_MAX_ORDERS; ++i)
+    {
+        EXPECT_EQ(bridge.getOrder(i).order.amount, 1 + i);
+    }
+    EXPECT_EQ(bridge.getOrder(ETHBRIDGE_MAX_ORDERS).status, 1);
+}
+
+TEST(ContractEthBridge, CompleteOrdersReportsPerOrderStatus)
+{
+    ContractTestingEthBridge bridge;
+
+    EXPECT_EQ(bridge.transferToContract(USER1, 600), 0);
+    EXPECT_EQ(bridge.createOrder(USER1, 100, true).orderId, 0);
+    EXPECT_EQ(bridge.createOrder(USER1, 200, true).orderId, 1);
+    EXPECT_EQ(bridge.createOrder(USER1, 500, true).orderId, 2);
+
+    // The received tokens cover orders 0 and 1 only; a failing entry does
+    // not stop the rest of the batch
+    ETHBRIDGE::completeOrders_output output = bridge.completeOrders({ 0, 1, 0, 2, 7 });
+    EXPECT_EQ(output.status, 0);
+    EXPECT_EQ(output.orderStatus.get(0), 0);
+    EXPECT_EQ(output.orderStatus.get(1), 0);
+    EXPECT_EQ(output.orderStatus.get(2), 3);
+    EXPECT_EQ(output.orderStatus.get(3), 4);
+    EXPECT_EQ(output.orderStatus.get(4), 2);
+    EXPECT_EQ(output.completedCount, 2);
+    EXPECT_EQ(output.completedAmount, 300);
+    EXPECT_EQ(bridge.getOrder(2).order.status, 0);
+
+    EXPECT_EQ(bridge.completeOrders({ 2 }, USER1).status, 1);
+    EXPECT_EQ(bridge.completeOrders(std::vector<uint64>(33, 2)).status, 2);
+    EXPECT_EQ(bridge.getOrder(2).order.status, 0);
+}
+
+TEST(ContractEthBridge, RefundOrdersPaysEachSenderOnce)
+{
+    ContractTestingEthBridge bridge;
+
+    bridge.lockTokens(600);
+    EXPECT_EQ(bridge.createOrder(USER1, 100, true).orderId, 1);
+    EXPECT_EQ(bridge.createOrder(USER1, 200, true).orderId, 2);
+    EXPECT_EQ(bridge.createOrder(USER2, 300, true).orderId, 3);
+
+    const sint64 user1Balance = getBalance(USER1);
+    const sint64 user2Balance = getBalance(USER2);
+    ETHBRIDGE::refundOrders_output output = bridge.refundOrders({ 1, 2, 3, 1, 9 });
+    EXPECT_EQ(output.status, 0);
+    EXPECT_EQ(output.orderStatus.get(0), 0);
+    EXPECT_EQ(output.orderStatus.get(1), 0);
+    EXPECT_EQ(output.orderStatus.get(2), 0);
+    EXPECT_EQ(output.orderStatus.get(3), 3);
+    EXPECT_EQ(output.orderStatus.get(4), 2);
+    EXPECT_EQ(output.refundedCount, 3);
+    EXPECT_EQ(output.totalReleased, 600);
+    EXPECT_EQ(getBalance(USER1), user1Balance + 300);
+    EXPECT_EQ(getBalance(USER2), user2Balance + 300);
+    EXPECT_EQ(bridge.getTotalLockedTokens(), 0);
+
+    EXPECT_EQ(bridge.refundOrders({ 1 }, USER1).status, 1);
+    EXPECT_EQ(bridge.refundOrders(std::vector<uint64>(65, 1)).status, 2);
+}
+
+TEST(ContractEthBridge, RefundKeepsQueuedPayoutsCovered)
+{
+    ContractTestingEthBridge bridge;
+
+    bridge.lockTokens(1000);
+    EXPECT_EQ(bridge.createOrder(USER1, 500, true).orderId, 1);
+
+    // More is owed to queued payouts than the contract holds, so nothing is
+    // left for refunds
+    bridge.getState()->overrideQueuedPayoutTotal(getBalance(ETHBRIDGE_ID) + 1);
+    EXPECT_EQ(bridge.refundOrder(1), 4);
+    ETHBRIDGE::refundOrders_output output = bridge.refundOrders({ 1 });
+    EXPECT_EQ(output.orderStatus.get(0), 4);
+    EXPECT_EQ(output.refundedCount, 0);
+    EXPECT_EQ(bridge.getOrder(1).order.status, 0);
+}
+
+TEST(ContractEthBridge, CreateOrdersAllocatesContiguousIds)
+{
+    ContractTestingEthBridge bridge;
+    const id otherAddress(0xA1A2A3A4A5A6A7A8ULL, 0xB1B2B3B4B5B6B7B8ULL, 0xC1C2C3C4ULL, 0);
+
+    EXPECT_EQ(bridge.createOrder(USER2, 50, true).orderId, 0);
+
+    ETHBRIDGE::createOrders_output output = bridge.createOrders(USER1, {
+        ETHBRIDGE::OrderRequest{ ETH_ADDRESS, 100, true },
+        ETHBRIDGE::OrderRequest{ otherAddress, 200, false },
+        ETHBRIDGE::OrderRequest{ ETH_ADDRESS, 300, true } }, 3 * TRANSACTION_FEE);
+    EXPECT_EQ(output.status, 0);
+    EXPECT_EQ(output.firstOrderId, 1);
+    EXPECT_EQ(output.orderCount, 3);
+
+    ETHBRIDGE::getOrder_output order = bridge.getOrder(2);
+    EXPECT_EQ(order.order.amount, 200);
+    EXPECT_EQ(order.order.originAccount, USER1);
+    EXPECT_EQ(order.order.destinationAccount, otherAddress);
+    EXPECT_FALSE(order.order.fromQubicToEthereum);
+    EXPECT_EQ(bridge.getOrder(3).order.amount, 300);
+
+    // Rejected batches create nothing and consume no order IDs
+    EXPECT_EQ(bridge.createOrders(USER1, {
+        ETHBRIDGE::OrderRequest{ ETH_ADDRESS, 100, true },
+        ETHBRIDGE::OrderRequest{ ETH_ADDRESS, 0, true } }, 2 * TRANSACTION_FEE).status, 1);
+    EXPECT_EQ(bridge.createOrders(USER1, {
+        ETHBRIDGE::OrderRequest{ ETH_ADDRESS, 100, true },
+        ETHBRIDGE::OrderRequest{ ETH_ADDRESS, 100, true } }, 2 * TRANSACTION_FEE - 1).status, 2);
+    EXPECT_EQ(bridge.createOrders(USER1, {}, TRANSACTION_FEE).status, 4);
+    EXPECT_EQ(bridge.getOrder(4).status, 1);
+    EXPECT_EQ(bridge.createOrder(USER2, 50, true).orderId, 4);
+}
+
+TEST(ContractEthBridge, CreateOrdersNeedsRoomForTheWholeBatch)
+{
+    ContractTestingEthBridge bridge;
+
+    for (uint64 i = 0; i < ETHBRIDGE_MAX_ORDERS - 1; ++i)
+    {
+        EXPECT_EQ(bridge.createOrder(USER1, 1, true).status, 0);
+    }
+
+    EXPECT_EQ(bridge.createOrders(USER1, {
+        ETHBRIDGE::OrderRequest{ ETH_ADDRESS, 100, true },
+        ETHBRIDGE::OrderRequest{ ETH_ADDRESS, 100, true } }, 2 * TRANSACTION_FEE).status, 3);
+    EXPECT_EQ(bridge.createOrders(USER1, {
+        ETHBRIDGE::OrderRequest{ ETH_ADDRESS, 100, true } }, TRANSACTION_FEE).status, 0);
+}
+
+TEST(ContractEthBridge, CreateOrderBindsDeposit)
+{
+    ContractTestingEthBridge bridge;
+
+    // Whatever is paid beyond the fee and the deposit goes back
+    ETHBRIDGE::createOrder_output output = bridge.createOrder(USER1, ETHBRIDGE::createOrder_input{ ETH_ADDRESS, 500, true, true, 0 }, TRANSACTION_FEE + 750);
+    EXPECT_EQ(output.status, 0);
+    EXPECT_EQ(getBalance(USER1), 250);
+    EXPECT_EQ(getBalance(ETHBRIDGE_ID), TRANSACTION_FEE + 500);
+
+    // The deposit pays for the order without a separate transferToContract
+    EXPECT_EQ(bridge.completeOrder(output.orderId), 0);
+    EXPECT_EQ(bridge.getTotalLockedTokens(), 500);
+}
+
+TEST(ContractEthBridge, RefundOrderPaysBackDeposit)
+{
+    ContractTestingEthBridge bridge;
+
+    EXPECT_EQ(bridge.createDepositOrder(USER1, 500).orderId, 0);
+    EXPECT_EQ(getBalance(USER1), 0);
+
+    EXPECT_EQ(bridge.refundOrder(0), 0);
+    EXPECT_EQ(getBalance(USER1), 500);
+    EXPECT_EQ(getBalance(ETHBRIDGE_ID), TRANSACTION_FEE);
+    EXPECT_EQ(bridge.refundOrder(0), 3);
+    EXPECT_EQ(bridge.getTotalLockedTokens(), 0);
+}
+
+TEST(ContractEthBridge, CreateOrderReturnsRejectedDeposits)
+{
+    ContractTestingEthBridge bridge;
+
+    // Deposits only fit Qubic -> Ethereum orders and must cover the amount
+    EXPECT_EQ(bridge.createOrder(USER1, ETHBRIDGE::createOrder_input{ ETH_ADDRESS, 500, false, true, 0 }, TRANSACTION_FEE + 500).status, 4);
+    EXPECT_EQ(getBalance(USER1), TRANSACTION_FEE + 500);
+    EXPECT_EQ(bridge.createOrder(USER1, ETHBRIDGE::createOrder_input{ ETH_ADDRESS, 500, true, true, 0 }, TRANSACTION_FEE + 499).status, 4);
+    EXPECT_EQ(getBalance(USER1), 2 * TRANSACTION_FEE + 999);
+    EXPECT_EQ(bridge.createOrder(USER1, ETHBRIDGE::createOrder_input{ ETH_ADDRESS, 0, true, true, 0 }, TRANSACTION_FEE).status, 1);
+    EXPECT_EQ(getBalance(USER1), 3 * TRANSACTION_FEE + 999);
+    EXPECT_EQ(getBalance(ETHBRIDGE_ID), 0);
+    EXPECT_EQ(bridge.getOrder(0).status, 1);
+}
+
+TEST(ContractEthBridge, AddManagerRejectsDuplicates)
+{
+    ContractTestingEthBridge bridge;
+    increaseEnergy(USER1, 1);
+    increaseEnergy(MANAGER2, 1);
+
+    EXPECT_EQ(bridge.addManager(MANAGER), 2);
+    EXPECT_EQ(bridge.addManager(NULL_ID), 2);
+    EXPECT_EQ(bridge.addManager(MANAGER2, USER1), 1);
+    EXPECT_EQ(bridge.completeOrder(0, MANAGER2), 1);
+
+    EXPECT_EQ(bridge.addManager(MANAGER2), 0);
+    EXPECT_EQ(bridge.completeOrder(0, MANAGER2), 2);
+    EXPECT_EQ(bridge.removeManager(MANAGER2), 0);
+    EXPECT_EQ(bridge.completeOrder(0, MANAGER2), 1);
+    EXPECT_EQ(bridge.addManager(MANAGER2), 0);
+}
+
+TEST(ContractEthBridge, AddManagerStopsAtCapacity)
+{
+    ContractTestingEthBridge bridge;
+
+    for (uint64 i = 1; i < ETHBRIDGE_MAX_MANAGERS; ++i)
+    {
+        EXPECT_EQ(bridge.addManager(id(100 + i, 0, 0, 0)), 0);
+    }
+    EXPECT_EQ(bridge.addManager(id(100, 0, 0, 0)), 3);
+}
+
+TEST(ContractEthBridge, GetOrdersPagesThroughOrderIds)
+{
+    ContractTestingEthBridge bridge;
+
+    for (uint64 i = 0; i < 20; ++i)
+    {
+        EXPECT_EQ(bridge.createOrder(USER1, 100 + i, true).orderId, i);
+    }
+
+    ETHBRIDGE::getOrders_output output = bridge.getOrders(0, 0);
+    EXPECT_EQ(output.count, 16);
+    EXPECT_EQ(output.nextOrderId, 16);
+    for (uint64 i = 0; i < output.count; ++i)
+    {
+        EXPECT_EQ(output.orders.get(i).orderId, i);
+        EXPECT_EQ(output.orders.get(i).amount, 100 + i);
+    }
+
+    output = bridge.getOrders(output.nextOrderId, 0);
+    EXPECT_EQ(output.count, 4);
+    EXPECT_EQ(output.orders.get(0).orderId, 16);
+    EXPECT_EQ(output.nextOrderId, 20);
+
+    output = bridge.getOrders(5, 3);
+    EXPECT_EQ(output.count, 3);
+    EXPECT_EQ(output.orders.get(2).orderId, 7);
+    EXPECT_EQ(output.nextOrderId, 8);
+
+    // Caught up: the cursor stays at the next unassigned ID
+    output = bridge.getOrders(20, 0);
+    EXPECT_EQ(output.count, 0);
+    EXPECT_EQ(output.nextOrderId, 20);
+}
+
+TEST(ContractEthBridge, PendingOrdersAreQueuedPerDirection)
+{
+    ContractTestingEthBridge bridge;
+
+    EXPECT_EQ(bridge.createOrder(USER1, 100, true).orderId, 0);
+    EXPECT_EQ(bridge.createOrder(USER1, 100, false).orderId, 1);
+    EXPECT_EQ(bridge.createOrder(USER1, 100, true).orderId, 2);
+    EXPECT_EQ(bridge.createOrder(USER1, 100, true).orderId, 3);
+    EXPECT_EQ(bridge.createOrder(USER1, 100, false).orderId, 4);
+
+    ETHBRIDGE::getPendingOrders_output output = bridge.getPendingOrders(true);
+    EXPECT_EQ(output.totalPending, 3);
+    EXPECT_EQ(output.count, 3);
+    EXPECT_EQ(output.orders.get(0).orderId, 0);
+    EXPECT_EQ(output.orders.get(1).orderId, 2);
+    EXPECT_EQ(output.orders.get(2).orderId, 3);
+
+    output = bridge.getPendingOrders(false);
+    EXPECT_EQ(output.totalPending, 2);
+    EXPECT_EQ(output.orders.get(0).orderId, 1);
+    EXPECT_EQ(output.orders.get(1).orderId, 4);
+
+    output = bridge.getPendingOrders(true, 1, true, 0);
+    EXPECT_EQ(output.count, 1);
+    EXPECT_EQ(output.orders.get(0).orderId, 2);
+
+    // Finished orders leave the queue; continuing after one restarts at the head
+    EXPECT_EQ(bridge.transferToContract(USER1, 100), 0);
+    EXPECT_EQ(bridge.completeOrder(2), 0);
+    output = bridge.getPendingOrders(true, 0, true, 2);
+    EXPECT_EQ(output.totalPending, 2);
+    EXPECT_EQ(output.count, 2);
+    EXPECT_EQ(output.orders.get(0).orderId, 0);
+    EXPECT_EQ(output.orders.get(1).orderId, 3);
+}
+
+TEST(ContractEthBridge, GetOrdersBySenderPagesNewestFirst)
+{
+    ContractTestingEthBridge bridge;
+
+    std::vector<uint64> user1Orders;
+    for (uint64 i = 0; i < 20; ++i)
+    {
+        user1Orders.push_back(bridge.createOrder(USER1, 100, true).orderId);
+        if (i % 5 == 0)
+        {
+            EXPECT_EQ(bridge.createOrder(USER2, 200, true).status, 0);
+        }
+    }
+
+    ETHBRIDGE::getOrdersBySender_output output = bridge.getOrdersBySender(USER1, 0, 0);
+    EXPECT_EQ(output.totalOrders, 20);
+    EXPECT_EQ(output.count, 16);
+    for (uint64 i = 0; i < output.count; ++i)
+    {
+        EXPECT_EQ(output.orders.get(i).orderId, user1Orders[19 - i]);
+        EXPECT_EQ(output.orders.get(i).originAccount, USER1);
+    }
+    EXPECT_EQ(output.nextOrderId, user1Orders[4]);
+
+    output = bridge.getOrdersBySender(USER1, output.nextOrderId, 0);
+    EXPECT_EQ(output.count, 4);
+    EXPECT_EQ(output.orders.get(0).orderId, user1Orders[3]);
+    EXPECT_EQ(output.orders.get(3).orderId, user1Orders[0]);
+    EXPECT_EQ(output.nextOrderId, 0);
+
+    output = bridge.getOrdersBySender(USER2, 0, 2);
+    EXPECT_EQ(output.totalOrders, 4);
+    EXPECT_EQ(output.count, 2);
+    EXPECT_EQ(output.orders.get(0).amount, 200);
+    EXPECT_NE(output.nextOrderId, 0);
+
+    output = bridge.getOrdersBySender(ADMIN, 0, 0);
+    EXPECT_EQ(output.totalOrders, 0);
+    EXPECT_EQ(output.count, 0);
+}
+
+TEST(ContractEthBridge, EndEpochRetiresFinishedOrders)
+{
+    ContractTestingEthBridge bridge;
+
+    EXPECT_EQ(bridge.transferToContract(USER1, 600), 0);
+    EXPECT_EQ(bridge.createOrder(USER1, 300, true).orderId, 0);
+    EXPECT_EQ(bridge.createOrder(USER1, 200, true).orderId, 1);
+    EXPECT_EQ(bridge.createOrder(USER1, 100, true).orderId, 2);
+    EXPECT_EQ(bridge.completeOrder(0), 0);
+    EXPECT_EQ(bridge.refundOrder(1), 0);
+
+    // Finished orders stay for retentionEpochs (2) epochs
+    bridge.endEpoch();
+    system.epoch = 101;
+    bridge.endEpoch();
+    EXPECT_EQ(bridge.getOrder(0).status, 0);
+    EXPECT_EQ(bridge.getOrder(1).status, 0);
+
+    system.epoch = 102;
+    bridge.endEpoch();
+    EXPECT_EQ(bridge.getOrder(0).status, 1);
+    EXPECT_EQ(bridge.getOrder(1).status, 1);
+    EXPECT_EQ(bridge.getOrder(2).status, 0);
+    EXPECT_EQ(bridge.getOrders(0, 0).count, 1);
+    EXPECT_EQ(bridge.getOrdersBySender(USER1, 0, 0).totalOrders, 1);
+
+    ETHBRIDGE::getRetiredSummary_output summary = bridge.getRetiredSummary();
+    EXPECT_EQ(summary.retentionEpochs, 2);
+    EXPECT_EQ(summary.summary.orderCount, 2);
+    EXPECT_EQ(summary.summary.completedAmount, 300);
+    EXPECT_EQ(summary.summary.refundedAmount, 200);
+    EXPECT_EQ(summary.summary.lastOrderId, 1);
+    EXPECT_EQ(summary.summary.lastEpoch, 102);
+    EXPECT_NE(summary.summary.digest, NULL_ID);
+
+    // The retired slots are handed out again
+    for (uint64 i = 1; i < ETHBRIDGE_MAX_ORDERS; ++i)
+    {
+        EXPECT_EQ(bridge.createOrder(USER1, 1, true).status, 0);
+    }
+    EXPECT_EQ(bridge.createOrder(USER1, 1, true).status, 3);
+}
+
+TEST(ContractEthBridge, SetRetentionEpochsNeedsAdmin)
+{
+    ContractTestingEthBridge bridge;
+    increaseEnergy(USER1, 1);
+
+    EXPECT_EQ(bridge.setRetentionEpochs(0, USER1), 1);
+    EXPECT_EQ(bridge.setRetentionEpochs(0), 0);
+    EXPECT_EQ(bridge.getRetiredSummary().retentionEpochs, 0);
+
+    // With no retention, orders finished this epoch are retired at its end
+    EXPECT_EQ(bridge.createDepositOrder(USER1, 100).orderId, 0);
+    EXPECT_EQ(bridge.refundOrder(0), 0);
+    bridge.endEpoch();
+    EXPECT_EQ(bridge.getOrder(0).status, 1);
+    EXPECT_EQ(bridge.getRetiredSummary().summary.refundedAmount, 100);
+}
+
+TEST(ContractEthBridge, CreateOrderRejectsEthAddressBeyondTwentyBytes)
+{
+    ContractTestingEthBridge bridge;
+    const id fullAddress(0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFULL, 0);
+
+    EXPECT_EQ(bridge.createOrder(USER1, ETHBRIDGE::createOrder_input{ id(0, 0, 0x100000000ULL, 0), 100, true, false, 0 }, TRANSACTION_FEE).status, 5);
+    EXPECT_EQ(bridge.createOrder(USER1, ETHBRIDGE::createOrder_input{ id(0, 0, 0, 1), 100, true, false, 0 }, TRANSACTION_FEE).status, 5);
+    EXPECT_EQ(bridge.createOrders(USER1, {
+        ETHBRIDGE::OrderRequest{ ETH_ADDRESS, 100, true },
+        ETHBRIDGE::OrderRequest{ id(0, 0, 0, 1), 100, true } }, 2 * TRANSACTION_FEE).status, 5);
+
+    // All 20 address bytes survive the packed order record
+    EXPECT_EQ(bridge.createOrder(USER1, ETHBRIDGE::createOrder_input{ fullAddress, 100, true, false, 0 }, TRANSACTION_FEE).orderId, 0);
+    EXPECT_EQ(bridge.getOrder(0).order.destinationAccount, fullAddress);
+}
+
+TEST(ContractEthBridge, GetStatsTracksOrdersAndErrors)
+{
+    ContractTestingEthBridge bridge;
+    increaseEnergy(USER1, 1);
+
+    ETHBRIDGE::getStats_output stats = bridge.getStats();
+    EXPECT_EQ(stats.transactionFee, TRANSACTION_FEE);
+    EXPECT_EQ(stats.freeSlots, ETHBRIDGE_MAX_ORDERS);
+    EXPECT_EQ(stats.occupiedSlots, 0);
+
+    EXPECT_EQ(bridge.transferToContract(USER1, 1000), 0);
+    EXPECT_EQ(bridge.createOrder(USER1, 300, true).orderId, 0);
+    EXPECT_EQ(bridge.createOrder(USER1, 200, false).orderId, 1);
+    EXPECT_EQ(bridge.createDepositOrder(USER1, 400).orderId, 2);
+
+    stats = bridge.getStats();
+    EXPECT_EQ(stats.orderCounts.get(0), 1);
+    EXPECT_EQ(stats.orderCounts.get(1), 2);
+    EXPECT_EQ(stats.pendingAmounts.get(0), 200);
+    EXPECT_EQ(stats.pendingAmounts.get(1), 700);
+    EXPECT_EQ(stats.orderDeposits, 400);
+    EXPECT_EQ(stats.occupiedSlots, 3);
+    EXPECT_EQ(stats.freeSlots, ETHBRIDGE_MAX_ORDERS - 3);
+    EXPECT_EQ(stats.totalReceivedTokens, 1000);
+
+    EXPECT_EQ(bridge.completeOrder(0), 0);
+    stats = bridge.getStats();
+    EXPECT_EQ(stats.orderCounts.get(1), 1);
+    EXPECT_EQ(stats.orderCounts.get((1 << 1) | 1), 1);
+    EXPECT_EQ(stats.pendingAmounts.get(1), 400);
+    EXPECT_EQ(stats.lockedTokens, 300);
+    EXPECT_EQ(stats.totalReceivedTokens, 700);
+
+    // Errors are counted under their own code
+    EXPECT_EQ(bridge.refundOrder(1, USER1), 1);
+    EXPECT_EQ(bridge.completeOrder(9), 2);
+    stats = bridge.getStats();
+    EXPECT_EQ(stats.errorCounts.get(ETHBRIDGE::EthBridgeError::onlyManagersCanCompleteOrders), 1);
+    EXPECT_EQ(stats.errorCounts.get(ETHBRIDGE::EthBridgeError::orderNotFound), 1);
+
+    EXPECT_EQ(bridge.refundOrder(1), 0);
+    stats = bridge.getStats();
+    EXPECT_EQ(stats.orderCounts.get(0), 0);
+    EXPECT_EQ(stats.orderCounts.get(2 << 1), 1);
+    EXPECT_EQ(stats.pendingAmounts.get(0), 0);
+    EXPECT_EQ(stats.lockedTokens, 100);
+}
+
+TEST(ContractEthBridge, LatencyHistogramBucketsCompletions)
+{
+    ContractTestingEthBridge bridge;
+
+    EXPECT_EQ(bridge.transferToContract(USER1, 800), 0);
+    for (uint64 i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ(bridge.createOrder(USER1, 100, true).orderId, i);
+    }
+
+    // Latencies 0, 1, 5 and 100000 ticks: buckets 0, 1, 3 and the last one
+    EXPECT_EQ(bridge.completeOrder(0), 0);
+    system.tick = 1001;
+    EXPECT_EQ(bridge.completeOrder(1), 0);
+    system.tick = 1005;
+    EXPECT_EQ(bridge.completeOrder(2), 0);
+    system.tick = 101000;
+    EXPECT_EQ(bridge.completeOrder(3), 0);
+
+    EXPECT_EQ(bridge.getOrder(2).order.createdTick, 1000);
+    EXPECT_EQ(bridge.getOrder(2).order.finishedTick, 1005);
+
+    ETHBRIDGE::getLatencyHistogram_output output = bridge.getLatencyHistogram();
+    for (uint64 bucket = 0; bucket < ETHBRIDGE_LATENCY_BUCKETS; ++bucket)
+    {
+        const uint64 expected = (bucket == 0 || bucket == 1 || bucket == 3 || bucket == ETHBRIDGE_LATENCY_BUCKETS - 1) ? 1 : 0;
+        EXPECT_EQ(output.buckets.get(ETHBRIDGE_LATENCY_BUCKETS + bucket), expected);
+        EXPECT_EQ(output.buckets.get(bucket), 0);
+    }
+    EXPECT_EQ(output.completedCount.get(1), 4);
+    EXPECT_EQ(output.totalLatencyTicks.get(1), 100006);
+    EXPECT_EQ(output.completedCount.get(0), 0);
+}
+
+TEST(ContractEthBridge, GetOrdersByIdsFlagsMissingOrders)
+{
+    ContractTestingEthBridge bridge;
+
+    for (uint64 i = 0; i < 3; ++i)
+    {
+        EXPECT_EQ(bridge.createOrder(USER1, 100 + i, true).orderId, i);
+    }
+
+    ETHBRIDGE::getOrdersByIds_output output = bridge.getOrdersByIds({ 2, 7, 0 });
+    EXPECT_EQ(output.status, 0);
+    EXPECT_EQ(output.foundCount, 2);
+    EXPECT_TRUE(output.found.get(0));
+    EXPECT_FALSE(output.found.get(1));
+    EXPECT_TRUE(output.found.get(2));
+    EXPECT_EQ(output.orders.get(0).orderId, 2);
+    EXPECT_EQ(output.orders.get(0).amount, 102);
+    EXPECT_EQ(output.orders.get(2).orderId, 0);
+
+    EXPECT_EQ(bridge.getOrdersByIds(std::vector<uint64>(33, 0)).status, 1);
+}
+
+TEST(ContractEthBridge, DeferredPayoutsSettleInEndTick)
+{
+    ContractTestingEthBridge bridge;
+    increaseEnergy(USER1, 1);
+
+    EXPECT_EQ(bridge.setPayoutMode(true, 1, USER1), 1);
+    EXPECT_EQ(bridge.setPayoutMode(true, 0), 2);
+    EXPECT_EQ(bridge.setPayoutMode(true, 1), 0);
+
+    bridge.lockTokens(600);
+    EXPECT_EQ(bridge.createOrder(USER1, 100, false).orderId, 1);
+    EXPECT_EQ(bridge.createOrder(USER1, 200, false).orderId, 2);
+    EXPECT_EQ(bridge.createOrder(USER2, 300, false).orderId, 3);
+
+    const sint64 user1Balance = getBalance(USER1);
+    const sint64 user2Balance = getBalance(USER2);
+    EXPECT_EQ(bridge.completeOrders({ 1, 2, 3 }).completedCount, 3);
+    EXPECT_EQ(getBalance(USER1), user1Balance);
+    EXPECT_EQ(getBalance(USER2), user2Balance);
+
+    // One transfer per recipient, oldest recipient first
+    ETHBRIDGE::getPayoutQueue_output queue = bridge.getPayoutQueue();
+    EXPECT_TRUE(queue.deferred);
+    EXPECT_EQ(queue.transfersPerTick, 1);
+    EXPECT_EQ(queue.queuedRecipients, 2);
+    EXPECT_EQ(queue.queuedAmount, 600);
+
+    bridge.endTick();
+    EXPECT_EQ(getBalance(USER1), user1Balance + 300);
+    EXPECT_EQ(getBalance(USER2), user2Balance);
+    EXPECT_EQ(bridge.getPayoutQueue().queuedAmount, 300);
+
+    bridge.endTick();
+    EXPECT_EQ(getBalance(USER2), user2Balance + 300);
+    queue = bridge.getPayoutQueue();
+    EXPECT_EQ(queue.queuedRecipients, 0);
+    EXPECT_EQ(queue.queuedAmount, 0);
+}
+
+TEST(ContractEthBridge, BatchZeroHashes)
+{
+    ContractTestingEthBridge bridge;
+
+    EXPECT_EQ(bridge.getState()->zeroHash(0), NULL_ID);
+    for (uint64 height = 1; height < ETHBRIDGE_BATCH_TREE_DEPTH; ++height)
+    {
+        EXPECT_EQ(bridge.getState()->zeroHash(height), zeroSubtreeRoot(height));
+    }
+}
+
+TEST(ContractEthBridge, BatchRoots)
+{
+    for (uint64 orderCount : { 1, 2, 3, 5, 16, 33 })
+    {
+        ContractTestingEthBridge bridge;
+        bridge.checkBatchRoot(orderCount);
+    }
+}
+
+TEST(ContractEthBridge, BatchesFollowTicks)
+{
+    ContractTestingEthBridge bridge;
+
+    // Ethereum -> Qubic completions are not committed
+    bridge.lockTokens(100);
+    bridge.endTick();
+    EXPECT_EQ(bridge.getBatch(0).batchCount, 1);
+    EXPECT_EQ(bridge.createOrder(USER1, 100, false).orderId, 1);
+    EXPECT_EQ(bridge.completeOrder(1), 0);
+    bridge.endTick();
+    EXPECT_EQ(bridge.getBatch(1).status, 1);
+    EXPECT_EQ(bridge.getBatch(1).batchCount, 1);
+
+    system.tick = 1001;
+    EXPECT_EQ(bridge.transferToContract(USER1, 600), 0);
+    EXPECT_EQ(bridge.createOrder(USER1, 100, true).orderId, 2);
+    EXPECT_EQ(bridge.createOrder(USER1, 200, true).orderId, 3);
+    EXPECT_EQ(bridge.completeOrder(3), 0);
+    EXPECT_EQ(bridge.completeOrder(2), 0);
+    bridge.endTick();
+
+    ETHBRIDGE::getBatch_output output = bridge.getBatch(1);
+    EXPECT_EQ(output.status, 0);
+    EXPECT_EQ(output.batch.tick, 1001);
+    EXPECT_EQ(output.batch.orderCount, 2);
+    EXPECT_EQ(output.batch.firstOrderId, 2);
+    EXPECT_EQ(output.batch.lastOrderId, 3);
+    EXPECT_EQ(output.batch.totalAmount, 300);
+}
+
+TEST(ContractEthBridge, FullBatchIsFinalizedEarly)
+{
+    ContractTestingEthBridge bridge;
+
+    // Order 0 becomes the last leaf of a batch that is one short of full,
+    // so order 1 has to start a new batch in the same tick
+    bridge.getState()->overrideOpenBatchOrderCount((1U << ETHBRIDGE_BATCH_TREE_DEPTH) - 2);
+    bridge.completeBatchTestOrders(0, 1);
+    EXPECT_EQ(bridge.getBatch(0).status, 1);
+    bridge.completeBatchTestOrders(1, 2);
+
+    ETHBRIDGE::getBatch_output output = bridge.getBatch(0);
+    EXPECT_EQ(output.status, 0);
+    EXPECT_EQ(output.batchCount, 1);
+    EXPECT_EQ(output.batch.orderCount, (1U << ETHBRIDGE_BATCH_TREE_DEPTH) - 1);
+
+    bridge.endTick();
+    output = bridge.getBatch(1);
+    EXPECT_EQ(output.status, 0);
+    EXPECT_EQ(output.batch.orderCount, 1);
+    EXPECT_EQ(output.batch.firstOrderId, 1);
+    EXPECT_EQ(output.batch.lastOrderId, 1);
+    EXPECT_EQ(output.batch.totalAmount, batchTestAmount(1));
+}
+
+TEST(ContractEthBridge, ExpirySweepRefundsQubicToEthereumOrders)
+{
+    ContractTestingEthBridge bridge;
+    EXPECT_EQ(bridge.setOrderTimeout(10), 0);
+
+    EXPECT_EQ(bridge.createDepositOrder(USER1, 500).orderId, 0);
+    EXPECT_EQ(bridge.createOrder(USER1, 300, true).orderId, 1);
+    EXPECT_EQ(bridge.createOrder(USER2, 200, false).orderId, 2);
+
+    system.tick = 1009;
+    bridge.endTick();
+    EXPECT_EQ(bridge.getStats().expiredOrders, 0);
+
+    // The deposit is paid back; the order without a deposit never handed
+    // its amount to the contract and is closed without a payout
+    system.tick = 1010;
+    const sint64 user1Balance = getBalance(USER1);
+    bridge.endTick();
+    EXPECT_EQ(getBalance(USER1), user1Balance + 500);
+    EXPECT_EQ(bridge.getOrder(0).order.status, 2);
+    EXPECT_EQ(bridge.getOrder(1).order.status, 2);
+    EXPECT_EQ(bridge.getStats().expiredOrders, 2);
+    EXPECT_EQ(bridge.getRetiredSummary().summary.refundedAmount, 0);
+
+    // Ethereum -> Qubic orders may already be burned on Ethereum, so they
+    // stay pending and can still be completed
+    EXPECT_EQ(bridge.getOrder(2).order.status, 0);
+    EXPECT_EQ(bridge.getPendingOrders(false).totalPending, 1);
+    bridge.lockTokens(200);
+    EXPECT_EQ(bridge.completeOrder(2), 0);
+}
+
+TEST(ContractEthBridge, ExpirySweepIsBoundedPerTick)
+{
+    ContractTestingEthBridge bridge;
+    EXPECT_EQ(bridge.setOrderTimeout(10), 0);
+
+    for (uint64 i = 0; i < ETHBRIDGE_EXPIRY_PER_TICK + 4; ++i)
+    {
+        EXPECT_EQ(bridge.createDepositOrder(USER1, 100).status, 0);
+    }
+
+    system.tick = 1010;
+    bridge.endTick();
+    EXPECT_EQ(bridge.getStats().expiredOrders, ETHBRIDGE_EXPIRY_PER_TICK);
+    EXPECT_EQ(bridge.getPendingOrders(true).totalPending, 4);
+
+    system.tick = 1011;
+    bridge.endTick();
+    EXPECT_EQ(bridge.getStats().expiredOrders, ETHBRIDGE_EXPIRY_PER_TICK + 4);
+    EXPECT_EQ(bridge.getPendingOrders(true).totalPending, 0);
+    EXPECT_EQ(getBalance(USER1), (ETHBRIDGE_EXPIRY_PER_TICK + 4) * 100);
+}
+
+TEST(ContractEthBridge, PriorityLaneOrdersByFeeThenAge)
+{
+    ContractTestingEthBridge bridge;
+
+    EXPECT_EQ(bridge.createOrder(USER1, 100, true).orderId, 0);
+    EXPECT_EQ(bridge.createOrder(USER1, ETHBRIDGE::createOrder_input{ ETH_ADDRESS, 100, true, false, 50 }, TRANSACTION_FEE + 50).orderId, 1);
+    EXPECT_EQ(bridge.createOrder(USER1, ETHBRIDGE::createOrder_input{ ETH_ADDRESS, 100, true, false, 50 }, TRANSACTION_FEE + 50).orderId, 2);
+    EXPECT_EQ(bridge.createOrder(USER1, ETHBRIDGE::createOrder_input{ ETH_ADDRESS, 100, false, false, 10 }, TRANSACTION_FEE + 10).orderId, 3);
+
+    // The priority fee has to be paid on top of the transaction fee
+    EXPECT_EQ(bridge.createOrder(USER1, ETHBRIDGE::createOrder_input{ ETH_ADDRESS, 100, true, false, 50 }, TRANSACTION_FEE + 49).status, 2);
+
+    ETHBRIDGE::getNextOrdersByPriority_output output = bridge.getNextOrdersByPriority(0);
+    EXPECT_EQ(output.totalPending, 4);
+    EXPECT_EQ(output.count, 4);
+    EXPECT_EQ(output.orders.get(0).orderId, 1);
+    EXPECT_EQ(output.orders.get(0).priorityFee, 50);
+    EXPECT_EQ(output.orders.get(1).orderId, 2);
+    EXPECT_EQ(output.orders.get(2).orderId, 3);
+    EXPECT_EQ(output.orders.get(3).orderId, 0);
+
+    // Finished orders leave the lane
+    EXPECT_EQ(bridge.transferToContract(USER1, 600), 0);
+    EXPECT_EQ(bridge.completeOrder(1), 0);
+    output = bridge.getNextOrdersByPriority(2);
+    EXPECT_EQ(output.totalPending, 3);
+    EXPECT_EQ(output.count, 2);
+    EXPECT_EQ(output.orders.get(0).orderId, 2);
+    EXPECT_EQ(output.orders.get(1).orderId, 3);
+
+    // The lane keeps working after running empty
+    EXPECT_EQ(bridge.completeOrder(2), 0);
+    EXPECT_EQ(bridge.completeOrder(3), 0);
+    EXPECT_EQ(bridge.completeOrder(0), 0);
+    bridge.endTick();
+    EXPECT_EQ(bridge.getNextOrdersByPriority(0).totalPending, 0);
+    EXPECT_EQ(bridge.createOrder(USER2, 100, true).orderId, 4);
+    output = bridge.getNextOrdersByPriority(0);
+    EXPECT_EQ(output.count, 1);
+    EXPECT_EQ(output.orders.get(0).orderId, 4);
+}
+
+TEST(ContractEthBridge, ShardOwnersRestrictCompletion)
+{
+    ContractTestingEthBridge bridge;
+    increaseEnergy(USER1, 1);
+    increaseEnergy(MANAGER2, 1);
+    EXPECT_EQ(bridge.addManager(MANAGER2), 0);
+
+    EXPECT_EQ(bridge.transferToContract(USER1, 400), 0);
+    for (uint64 i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ(bridge.createOrder(USER1, 100, true).orderId, i);
+    }
+    ASSERT_NE(orderShard(1), orderShard(2));
+
+    EXPECT_EQ(bridge.setShardOwner(orderShard(1), MANAGER2, USER1), 1);
+    EXPECT_EQ(bridge.setShardOwner(ETHBRIDGE_SHARD_COUNT, MANAGER2), 2);
+    EXPECT_EQ(bridge.setShardOwner(orderShard(1), USER1), 2);
+    EXPECT_EQ(bridge.setShardOwner(orderShard(1), MANAGER2), 0);
+    EXPECT_EQ(bridge.getShardOwners().owners.get(orderShard(1)), MANAGER2);
+
+    // Only the owner may finish orders of an owned shard; unowned shards
+    // stay open to every manager
+    EXPECT_EQ(bridge.completeOrder(1), 7);
+    EXPECT_EQ(bridge.refundOrder(1), 5);
+    EXPECT_EQ(bridge.completeOrders({ 1, 2 }).orderStatus.get(0), 7);
+    EXPECT_EQ(bridge.refundOrders({ 1 }).orderStatus.get(0), 5);
+    EXPECT_EQ(bridge.getOrder(2).order.status, 1);
+
+    ETHBRIDGE::getPendingOrdersForManager_output output = bridge.getPendingOrdersForManager(MANAGER2, false);
+    EXPECT_TRUE(output.reachedEnd);
+    for (uint64 i = 0; i < output.count; ++i)
+    {
+        EXPECT_EQ(orderShard(output.orders.get(i).orderId), orderShard(1));
+    }
+    EXPECT_GE(output.count, 1);
+    EXPECT_EQ(bridge.getPendingOrdersForManager(MANAGER, true).count + output.count, 3);
+    EXPECT_EQ(bridge.completeOrder(1, MANAGER2), 0);
+
+    // Removing the manager hands its shards back to everyone
+    EXPECT_EQ(bridge.removeManager(MANAGER2), 0);
+    EXPECT_EQ(bridge.getShardOwners().owners.get(orderShard(1)), NULL_ID);
+}